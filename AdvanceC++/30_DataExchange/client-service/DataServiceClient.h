@@ -0,0 +1,510 @@
+// DataServiceClient.h
+// Thread-safe client of the data-service binary protocol: a connection pool over one
+// or more endpoints, with asynchronous name resolution, health checks and reconnects
+
+#ifndef DATASERVICECLIENT_H
+#define DATASERVICECLIENT_H
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include "../common/Protocol.h"
+
+/*
+* Many threads call sum() at once; each call borrows a pooled connection for one
+* request and gives it back, so no call pays for a connect or a name lookup.
+*
+* - Name resolution: getaddrinfo() blocks and its timeout cannot be chosen, so every
+*   endpoint has a Resolver thread of its own. Only the health thread looks names up,
+*   when it reconnects an endpoint, so a restarted service on a new address is found;
+*   the pool connects to the addresses of the last successful lookup. A lookup that
+*   has not finished is not a failure of the endpoint: the cached addresses are used
+*   meanwhile, or the reconnect is retried shortly when there are none yet.
+* - Load spreading: a call takes a connection of the healthy endpoint with the fewest
+*   calls in flight, opening one if that endpoint has fewer than connectionsPerEndpoint.
+* - Failures: a connect, send or receive error closes the connection and marks its
+*   endpoint unhealthy (its idle connections are closed as well), and the call is
+*   retried on another connection. An unhealthy endpoint gets no calls until it is
+*   reconnected.
+* - Reconnects and health checks: a background thread reconnects unhealthy endpoints
+*   with exponential backoff and jitter (minBackoff, doubled per failure up to
+*   maxBackoff), and every healthCheckInterval sends a probe request (the sum of
+*   no numbers) over an idle connection of each healthy endpoint.
+*/
+
+struct Endpoint {
+    std::string host;
+    int port;
+};
+
+// Parse "host:port,host:port"; a missing port is defaultPort
+inline std::vector<Endpoint> parseEndpoints(const std::string& list, int defaultPort) {
+    std::vector<Endpoint> endpoints;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string item = list.substr(start, end - start);
+        if (!item.empty()) {
+            size_t colon = item.rfind(':');
+            if (colon == std::string::npos)
+                endpoints.push_back(Endpoint{item, defaultPort});
+            else
+                endpoints.push_back(Endpoint{item.substr(0, colon), atoi(item.c_str() + colon + 1)});
+        }
+        start = end + 1;
+    }
+    return endpoints;
+}
+
+struct ResolvedAddress {
+    sockaddr_storage storage;
+    socklen_t length;
+    int family;
+};
+
+// Looks up one host with getaddrinfo() on a worker thread of its own, so a host whose
+// lookups hang (a dead DNS server takes seconds per attempt) delays no other host. A
+// lookup asked for while one is running shares it: nothing queues behind a slow one.
+class Resolver {
+private:
+    typedef std::shared_future<std::vector<ResolvedAddress>> Lookup;
+
+    std::string host;
+    int port;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::promise<std::vector<ResolvedAddress>> pending;
+    Lookup current;
+    bool requested = false;
+    bool stopping = false;
+    std::thread worker;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wakeup.wait(lock, [this] { return stopping || requested; });
+            if (stopping)
+                return;
+            requested = false;
+            std::promise<std::vector<ResolvedAddress>> result = std::move(pending);
+            lock.unlock();
+
+            addrinfo hints{};
+            hints.ai_family = AF_UNSPEC;
+            hints.ai_socktype = SOCK_STREAM;
+            addrinfo* list = nullptr;
+            std::vector<ResolvedAddress> addresses;
+            if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &list) == 0) {
+                for (addrinfo* info = list; info; info = info->ai_next) {
+                    ResolvedAddress address{};
+                    memcpy(&address.storage, info->ai_addr, info->ai_addrlen);
+                    address.length = info->ai_addrlen;
+                    address.family = info->ai_family;
+                    addresses.push_back(address);
+                }
+                freeaddrinfo(list);
+            }
+            result.set_value(std::move(addresses)); // Empty when the lookup failed
+            lock.lock();
+        }
+    }
+
+public:
+    Resolver(const std::string& hostName, int hostPort)
+        : host(hostName), port(hostPort), worker(&Resolver::run, this) {}
+
+    ~Resolver() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        worker.join();
+    }
+
+    Resolver(const Resolver&) = delete;
+    Resolver& operator=(const Resolver&) = delete;
+
+    // Start a lookup, or join the one running
+    Lookup resolve() {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (current.valid() && current.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            return current;
+        pending = std::promise<std::vector<ResolvedAddress>>();
+        current = pending.get_future().share();
+        requested = true;
+        wakeup.notify_one();
+        return current;
+    }
+};
+
+struct ClientOptions {
+    size_t connectionsPerEndpoint = 4;
+    std::chrono::milliseconds connectTimeout{1000};
+    std::chrono::milliseconds requestTimeout{2000}; // Per call, waiting for a connection included
+    std::chrono::milliseconds minBackoff{100};
+    std::chrono::milliseconds maxBackoff{10000};
+    std::chrono::milliseconds healthCheckInterval{1000};
+    int attempts = 3; // Connections a call tries before it fails
+};
+
+class DataServiceClient {
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct EndpointState {
+        Endpoint endpoint;
+        std::unique_ptr<Resolver> resolver;
+        std::vector<ResolvedAddress> addresses; // Last successful lookup
+        std::vector<int> idle;  // Connected sockets not in use
+        size_t open = 0;        // Sockets open, idle or in use
+        size_t inUse = 0;
+        bool healthy = false;   // Connected and answering; starts unknown
+        bool connecting = false; // The health thread is reconnecting it
+        int failures = 0;
+        Clock::time_point retryAt;
+    };
+
+    struct Lease {
+        size_t endpoint;
+        int fd = -1;
+    };
+
+    ClientOptions options;
+    std::mutex mutex;
+    std::condition_variable changed; // A connection was released or an endpoint came up
+    std::condition_variable healthWakeup; // An endpoint failed: schedule its reconnect
+    std::vector<EndpointState> endpoints;
+    std::mt19937 rng{std::random_device{}()};
+    size_t nextEndpoint = 0; // Round-robin start, to break ties
+    bool stopping = false;
+    std::atomic<uint32_t> nextRequestId{1};
+    std::atomic<size_t> connectionsOpened{0};
+    std::atomic<size_t> failuresSeen{0};
+    std::thread healthThread;
+
+    // Connect to the first address that accepts, within connectTimeout. Returns the
+    // blocking socket, or -1.
+    int connectTo(const std::vector<ResolvedAddress>& addresses) {
+        auto deadline = Clock::now() + options.connectTimeout;
+        for (const ResolvedAddress& address : addresses) {
+            int fd = socket(address.family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if (fd < 0)
+                continue;
+            bool connected = connect(fd, (const sockaddr*)&address.storage, address.length) == 0;
+            if (!connected && errno == EINPROGRESS) {
+                int waitMs = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now()).count();
+                pollfd pending{fd, POLLOUT, 0};
+                int error = 0;
+                socklen_t length = sizeof(error);
+                connected = waitMs > 0 && poll(&pending, 1, waitMs) == 1 &&
+                    getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) == 0 && error == 0;
+            }
+            if (!connected) {
+                close(fd);
+                continue;
+            }
+
+            // Blocking from now on, with the request timeout on every send and receive
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            timeval timeout{};
+            timeout.tv_sec = options.requestTimeout.count() / 1000;
+            timeout.tv_usec = (options.requestTimeout.count() % 1000) * 1000;
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+            connectionsOpened++;
+            return fd;
+        }
+        return -1;
+    }
+
+    // One request and its response on a connection. Returns false when the connection
+    // failed; ok tells whether the service answered with a sum.
+    bool exchange(int fd, const std::vector<int>& numbers, int64_t& sum, bool& ok) {
+        uint32_t requestId = nextRequestId++;
+        std::string request;
+        protocol::appendSumRequest(request, requestId, numbers);
+        for (size_t sent = 0; sent < request.size();) {
+            ssize_t written = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0)
+                return false;
+            sent += written;
+        }
+
+        protocol::FrameDecoder decoder;
+        protocol::Frame response;
+        char buffer[4096];
+        while (true) {
+            protocol::DecodeStatus status = decoder.next(response);
+            if (status == protocol::INVALID)
+                return false;
+            if (status == protocol::COMPLETE)
+                break;
+            ssize_t bytesRead = read(fd, buffer, sizeof(buffer));
+            if (bytesRead <= 0)
+                return false; // Closed, reset or timed out
+            decoder.feed(buffer, bytesRead);
+        }
+        if (response.header.requestId != requestId || decoder.buffered() > 0)
+            return false; // Out of step with the service: do not reuse the connection
+        ok = response.header.type == protocol::SUM_RESPONSE && response.header.length == 8;
+        sum = ok ? protocol::sumOf(response) : 0;
+        return true;
+    }
+
+    // With the lock held: the endpoint failed, close its idle connections and back off
+    void markFailed(EndpointState& state) {
+        failuresSeen++;
+        for (int fd : state.idle)
+            close(fd);
+        state.open -= state.idle.size();
+        state.idle.clear();
+        state.healthy = false;
+        state.failures++;
+
+        // Exponential backoff with jitter, so clients do not reconnect in lockstep
+        long long backoff = options.minBackoff.count() << std::min(state.failures - 1, 20);
+        backoff = std::min<long long>(backoff, options.maxBackoff.count());
+        std::uniform_int_distribution<long long> jitter(backoff / 2, backoff);
+        state.retryAt = Clock::now() + std::chrono::milliseconds(jitter(rng));
+        healthWakeup.notify_one();
+    }
+
+    // With the lock held: the healthy endpoint with a connection to spare and the
+    // fewest calls in flight, or endpoints.size()
+    size_t pickEndpoint() {
+        size_t best = endpoints.size();
+        for (size_t k = 0; k < endpoints.size(); k++) {
+            size_t i = (nextEndpoint + k) % endpoints.size();
+            EndpointState& state = endpoints[i];
+            bool spare = !state.idle.empty() || state.open < options.connectionsPerEndpoint;
+            if (state.healthy && spare && (best == endpoints.size() || state.inUse < endpoints[best].inUse))
+                best = i;
+        }
+        nextEndpoint++;
+        return best;
+    }
+
+    // Borrow a connection, waiting until the deadline for one to be free or for an
+    // endpoint to come up. Returns a lease with fd -1 on timeout.
+    Lease acquire(Clock::time_point deadline) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            size_t i = pickEndpoint();
+            if (i == endpoints.size()) {
+                // Every endpoint is busy or down: wait for a release or a reconnect
+                if (changed.wait_until(lock, deadline) == std::cv_status::timeout)
+                    break;
+                continue;
+            }
+
+            EndpointState& state = endpoints[i];
+            state.inUse++;
+            if (!state.idle.empty()) {
+                int fd = state.idle.back();
+                state.idle.pop_back();
+                return Lease{i, fd};
+            }
+
+            // Open another connection to the endpoint, without holding the lock
+            state.open++;
+            std::vector<ResolvedAddress> addresses = state.addresses;
+            lock.unlock();
+            int fd = connectTo(addresses);
+            lock.lock();
+            if (fd >= 0)
+                return Lease{i, fd};
+            state.inUse--;
+            state.open--;
+            markFailed(state);
+        }
+        return Lease{0, -1};
+    }
+
+    // Give the connection back, or close it when it failed
+    void release(const Lease& lease, bool healthy) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            EndpointState& state = endpoints[lease.endpoint];
+            state.inUse--;
+            if (healthy && state.healthy && !stopping) {
+                state.idle.push_back(lease.fd);
+            } else {
+                close(lease.fd);
+                state.open--;
+                if (!healthy && state.healthy)
+                    markFailed(state);
+            }
+        }
+        changed.notify_one();
+    }
+
+    // Reconnect unhealthy endpoints when their backoff expires, and probe healthy ones
+    void healthCheck() {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto nextProbe = Clock::now() + options.healthCheckInterval;
+        while (!stopping) {
+            auto now = Clock::now();
+            for (size_t i = 0; i < endpoints.size() && !stopping; i++) {
+                EndpointState& state = endpoints[i];
+                if (!state.healthy && !state.connecting && now >= state.retryAt) {
+                    // Look the name up again. With addresses cached, a lookup that is not
+                    // done yet does not hold up the other endpoints: the cache is used.
+                    state.connecting = true;
+                    std::shared_future<std::vector<ResolvedAddress>> lookup = state.resolver->resolve();
+                    std::vector<ResolvedAddress> addresses = state.addresses;
+                    lock.unlock();
+                    auto wait = addresses.empty() ? options.connectTimeout : std::chrono::milliseconds(0);
+                    bool done = lookup.wait_for(wait) == std::future_status::ready;
+                    bool resolved = done && !lookup.get().empty();
+                    if (resolved)
+                        addresses = lookup.get();
+                    int fd = addresses.empty() ? -1 : connectTo(addresses);
+                    int64_t sum = 0;
+                    bool ok = false;
+                    bool alive = fd >= 0 && exchange(fd, {}, sum, ok) && ok;
+                    lock.lock();
+                    state.connecting = false;
+                    if (resolved)
+                        state.addresses = addresses;
+                    if (!done && addresses.empty()) {
+                        // Still looking the name up: not a failure of the endpoint
+                        state.retryAt = Clock::now() + options.minBackoff;
+                    } else if (alive && !stopping) {
+                        state.healthy = true;
+                        state.failures = 0;
+                        state.idle.push_back(fd);
+                        state.open++;
+                        changed.notify_all();
+                    } else {
+                        if (fd >= 0)
+                            close(fd);
+                        markFailed(state);
+                    }
+                } else if (state.healthy && now >= nextProbe && !state.idle.empty()) {
+                    // Probe an idle connection: a service that went away is noticed before
+                    // calls fail on it
+                    Lease lease{i, state.idle.back()};
+                    state.idle.pop_back();
+                    state.inUse++;
+                    lock.unlock();
+                    int64_t sum = 0;
+                    bool ok = false;
+                    bool alive = exchange(lease.fd, {}, sum, ok) && ok;
+                    release(lease, alive);
+                    lock.lock();
+                }
+            }
+            if (now >= nextProbe)
+                nextProbe = now + options.healthCheckInterval;
+
+            // Sleep until the next probe or the next backoff to expire
+            auto wakeAt = nextProbe;
+            for (EndpointState& state : endpoints)
+                if (!state.healthy && !state.connecting)
+                    wakeAt = std::min(wakeAt, state.retryAt);
+            if (!stopping)
+                healthWakeup.wait_until(lock, wakeAt);
+        }
+    }
+
+public:
+    DataServiceClient(const std::vector<Endpoint>& serviceEndpoints, const ClientOptions& clientOptions = ClientOptions())
+        : options(clientOptions) {
+        endpoints.resize(serviceEndpoints.size());
+        for (size_t i = 0; i < serviceEndpoints.size(); i++) {
+            EndpointState& state = endpoints[i];
+            state.endpoint = serviceEndpoints[i];
+            state.resolver.reset(new Resolver(state.endpoint.host, state.endpoint.port));
+            state.retryAt = Clock::now(); // Unknown: connect right away
+        }
+        healthThread = std::thread(&DataServiceClient::healthCheck, this);
+    }
+
+    ~DataServiceClient() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        healthWakeup.notify_all();
+        healthThread.join();
+        for (EndpointState& state : endpoints)
+            for (int fd : state.idle)
+                close(fd);
+    }
+
+    DataServiceClient(const DataServiceClient&) = delete;
+    DataServiceClient& operator=(const DataServiceClient&) = delete;
+
+    // Thread-safe. Returns false when the service could not be reached within
+    // requestTimeout (after up to `attempts` connections) or answered with an error.
+    bool sum(const std::vector<int>& numbers, int64_t& result) {
+        auto deadline = Clock::now() + options.requestTimeout;
+        for (int attempt = 0; attempt < options.attempts; attempt++) {
+            Lease lease = acquire(deadline);
+            if (lease.fd < 0)
+                return false;
+            bool ok = false;
+            bool healthy = exchange(lease.fd, numbers, result, ok);
+            release(lease, healthy);
+            if (healthy)
+                return ok;
+        }
+        return false;
+    }
+
+    // Wait until an endpoint is up. Returns false on timeout.
+    bool waitUntilReady(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_for(lock, timeout, [this] {
+            for (EndpointState& state : endpoints)
+                if (state.healthy)
+                    return true;
+            return false;
+        });
+    }
+
+    // A connection of the caller's own, outside the pool (for pipelining), to the
+    // least loaded healthy endpoint. Returns -1 when none is up.
+    int openConnection() {
+        std::unique_lock<std::mutex> lock(mutex);
+        size_t best = endpoints.size();
+        for (size_t i = 0; i < endpoints.size(); i++)
+            if (endpoints[i].healthy && (best == endpoints.size() || endpoints[i].inUse < endpoints[best].inUse))
+                best = i;
+        if (best == endpoints.size())
+            return -1;
+        std::vector<ResolvedAddress> addresses = endpoints[best].addresses;
+        lock.unlock();
+        return connectTo(addresses);
+    }
+
+    size_t getConnectionsOpened() const { return connectionsOpened; }
+    size_t getFailures() const { return failuresSeen; }
+};
+
+#endif
@@ -0,0 +1,150 @@
+// PipelinedClient.h
+// Keeps many binary-protocol requests in flight on one connection
+
+#ifndef PIPELINEDCLIENT_H
+#define PIPELINEDCLIENT_H
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <climits>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <functional>
+#include <unordered_map>
+#include <algorithm>
+#include "../common/Protocol.h"
+
+/*
+* Sending one request and waiting for its answer costs a network round trip per
+* request. This client pipelines instead:
+*
+* - submit() encodes the request and queues it. The queued frames are written together
+*   with one writev() once `batchSize` of them are waiting (or on flush()), so a batch
+*   costs one system call and goes out in as few TCP segments as possible.
+* - Up to `maxInFlight` requests are sent and unanswered at any time; submit() reads
+*   responses when the window is full. The window also bounds the bytes the server
+*   can have queued for us, so neither side blocks writing while the other is writing.
+* - Responses are matched to their requests by request id, so they may arrive in any
+*   order. Each request's callback gets its sum and its latency from submit() to the
+*   response.
+*
+* The socket is blocking and the client is used by one thread.
+*/
+
+class PipelinedClient {
+public:
+    typedef std::function<void(uint32_t requestId, bool ok, int64_t sum, double latencyUs)> Callback;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Pending {
+        Clock::time_point submittedAt;
+        Callback done;
+    };
+
+    int sock;
+    size_t maxInFlight;
+    size_t batchSize;
+    uint32_t nextRequestId = 1;
+    std::vector<std::string> queued; // Encoded frames not written yet
+    std::unordered_map<uint32_t, Pending> pending; // Queued or sent, not answered
+    protocol::FrameDecoder decoder;
+    size_t unknownResponses = 0;
+
+    // Read once (blocking) and dispatch every complete response. Returns false when
+    // the connection is lost or the stream is corrupt.
+    bool readResponses() {
+        char buffer[64 * 1024];
+        ssize_t bytesRead = read(sock, buffer, sizeof(buffer));
+        if (bytesRead < 0 && errno == EINTR)
+            return true;
+        if (bytesRead <= 0)
+            return false;
+        decoder.feed(buffer, bytesRead);
+
+        protocol::Frame frame;
+        protocol::DecodeStatus status;
+        while ((status = decoder.next(frame)) == protocol::COMPLETE) {
+            auto it = pending.find(frame.header.requestId);
+            if (it == pending.end()) {
+                unknownResponses++;
+                continue;
+            }
+            double latencyUs = std::chrono::duration<double, std::micro>(Clock::now() - it->second.submittedAt).count();
+            bool ok = frame.header.type == protocol::SUM_RESPONSE && frame.header.length == 8;
+            Callback done = std::move(it->second.done);
+            pending.erase(it);
+            done(frame.header.requestId, ok, ok ? protocol::sumOf(frame) : 0, latencyUs);
+        }
+        return status != protocol::INVALID;
+    }
+
+public:
+    PipelinedClient(int connectedSocket, size_t maxRequestsInFlight, size_t requestsPerBatch)
+        : sock(connectedSocket), maxInFlight(std::max<size_t>(1, maxRequestsInFlight)),
+          batchSize(std::min<size_t>(std::max<size_t>(1, requestsPerBatch), IOV_MAX)) {
+        pending.reserve(maxInFlight);
+    }
+
+    size_t inFlight() const { return pending.size(); }
+    size_t getUnknownResponses() const { return unknownResponses; }
+
+    // Queue a request; done is called when its response arrives. Returns false when
+    // the connection is lost.
+    bool submit(const std::vector<int>& numbers, Callback done) {
+        // Make room in the window: what is queued must go out before we wait for answers
+        while (pending.size() >= maxInFlight) {
+            if (!flush() || !readResponses())
+                return false;
+        }
+
+        uint32_t requestId = nextRequestId++;
+        queued.emplace_back();
+        protocol::appendSumRequest(queued.back(), requestId, numbers);
+        pending[requestId] = Pending{Clock::now(), std::move(done)};
+        return queued.size() < batchSize || flush();
+    }
+
+    // Write every queued request with one writev() (more if the kernel takes part of it)
+    bool flush() {
+        std::vector<iovec> iov(queued.size());
+        for (size_t i = 0; i < queued.size(); i++)
+            iov[i] = iovec{&queued[i][0], queued[i].size()};
+
+        size_t first = 0;
+        while (first < iov.size()) {
+            ssize_t written = writev(sock, &iov[first], (int)(iov.size() - first));
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            // Skip the buffers written completely, then trim the partly written one
+            while (first < iov.size() && (size_t)written >= iov[first].iov_len)
+                written -= iov[first++].iov_len;
+            if (first < iov.size()) {
+                iov[first].iov_base = (char*)iov[first].iov_base + written;
+                iov[first].iov_len -= written;
+            }
+        }
+        queued.clear();
+        return true;
+    }
+
+    // Send what is queued and wait for every response. Returns false when the
+    // connection is lost.
+    bool drain() {
+        if (!flush())
+            return false;
+        while (!pending.empty())
+            if (!readResponses())
+                return false;
+        return true;
+    }
+};
+
+#endif
@@ -1,45 +1,118 @@
 #include <iostream>
-#include <sys/socket.h>
-#include <arpa/inet.h>
-#include <netdb.h> // For gethostbyname
 #include <unistd.h>
 #include <cstring>
 #include <vector>
 #include <sstream>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include "PipelinedClient.h"
+#include "DataServiceClient.h"
 
-#define PORT 8080
+#define PORT 8081 // Binary protocol port of the data-service
+#define ENDPOINTS "data-service:8081"
 
-int main() {
-    int sock = 0;
-    struct sockaddr_in serv_addr;
-    struct hostent* server;
-    char buffer[1024] = {0};
+double percentile(const std::vector<double>& sorted, double p) {
+    if (sorted.empty())
+        return 0.0;
+    return sorted[(size_t)(p * (sorted.size() - 1) + 0.5)];
+}
 
-    // Creating socket file descriptor
-    if ((sock = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-        std::cerr << "Socket creation error!" << std::endl;
-        return -1;
+// Send `requests` sums of ten numbers and report throughput and latency. Returns false
+// when the connection is lost.
+bool runBenchmark(int sock, const char* name, size_t requests, size_t window, size_t batch) {
+    PipelinedClient client(sock, window, batch);
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    std::vector<double> latencyUs;
+    latencyUs.reserve(requests);
+    size_t errors = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < requests; i++) {
+        bool sent = client.submit(numbers, [&](uint32_t, bool ok, int64_t sum, double latency) {
+            errors += !ok || sum != 55;
+            latencyUs.push_back(latency);
+        });
+        if (!sent)
+            return false;
     }
+    if (!client.drain())
+        return false;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-    // Get the server (data-service) details by name
-    server = gethostbyname("data-service");
-    if (server == NULL) {
-        std::cerr << "Host not found!" << std::endl;
-        return -1;
+    std::sort(latencyUs.begin(), latencyUs.end());
+    printf("%-20s %7zu %6zu %10.0f %10.1f %10.1f %10.1f %7zu\n", name, window, batch, requests / seconds,
+        percentile(latencyUs, 0.50), percentile(latencyUs, 0.99), percentile(latencyUs, 1.0), errors);
+    return true;
+}
+
+// Send `requests` sums of ten numbers from `threads` threads sharing the client's pooled
+// connections, and report throughput and latency
+void runPooledBenchmark(DataServiceClient& client, size_t requests, size_t threads, size_t connections) {
+    std::vector<int> numbers = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    std::vector<std::vector<double>> latencyUs(threads);
+    std::vector<size_t> errors(threads, 0);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < threads; t++) {
+        workers.emplace_back([&, t]() {
+            for (size_t i = t; i < requests; i += threads) {
+                auto sent = std::chrono::steady_clock::now();
+                int64_t sum = 0;
+                errors[t] += !client.sum(numbers, sum) || sum != 55;
+                latencyUs[t].push_back(
+                    std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent).count());
+            }
+        });
+    }
+    for (std::thread& worker : workers)
+        worker.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> all;
+    size_t totalErrors = 0;
+    for (size_t t = 0; t < threads; t++) {
+        all.insert(all.end(), latencyUs[t].begin(), latencyUs[t].end());
+        totalErrors += errors[t];
     }
+    std::sort(all.begin(), all.end());
+    std::string name = "pool, " + std::to_string(threads) + " threads";
+    printf("%-20s %7zu %6d %10.0f %10.1f %10.1f %10.1f %7zu\n", name.c_str(), connections, 1, requests / seconds,
+        percentile(all, 0.50), percentile(all, 0.99), percentile(all, 1.0), totalErrors);
+}
 
-    // Set server address details
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(PORT);
-    bcopy((char*)server->h_addr, (char*)&serv_addr.sin_addr.s_addr, server->h_length);
+// Usage: client-service [requests] [requests in flight] [requests per batch] [threads]
+// Defaults: 20000 128 16 8
+// The data-service endpoints are read from DATA_SERVICE_ENDPOINTS ("host:port,host:port",
+// default data-service:8081); calls are spread over the endpoints that are up.
+int main(int argc, char* argv[]) {
+    size_t requests = argc > 1 ? strtoul(argv[1], nullptr, 10) : 20000;
+    size_t window = argc > 2 ? strtoul(argv[2], nullptr, 10) : 128;
+    size_t batch = argc > 3 ? strtoul(argv[3], nullptr, 10) : 16;
+    size_t threads = argc > 4 ? strtoul(argv[4], nullptr, 10) : 8;
+    if (threads == 0)
+        threads = 1;
+    const char* endpointList = getenv("DATA_SERVICE_ENDPOINTS");
+    std::vector<Endpoint> endpoints = parseEndpoints(endpointList ? endpointList : ENDPOINTS, PORT);
+    if (endpoints.empty()) {
+        std::cerr << "No data-service endpoint!" << std::endl;
+        return -1;
+    }
 
-    // Connect to the server (data-service)
-    if (connect(sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) < 0) {
+    // Connects in the background and keeps reconnecting until the data-service is up
+    ClientOptions options;
+    options.connectionsPerEndpoint = std::max<size_t>(1, threads / endpoints.size());
+    DataServiceClient client(endpoints, options);
+    if (!client.waitUntilReady(std::chrono::seconds(30))) {
         std::cerr << "Connection to data-service failed!" << std::endl;
         return -1;
     }
 
-    // Send sets of numbers to server
+    // Send sets of numbers to server, one thread per set sharing the pooled connections
     std::vector<std::vector<int>> numberSets = {
         {1, 2, 3, 4, 5},
         {10, 20, 30},
@@ -47,28 +120,46 @@ int main() {
         {7, 14, 21},
         {99, 1}
     };
-    
-    for (const auto& numbers : numberSets) {
+    std::vector<int64_t> sums(numberSets.size());
+    std::vector<char> answered(numberSets.size());
+    std::vector<std::thread> senders;
+    for (size_t k = 0; k < numberSets.size(); k++)
+        senders.emplace_back([&, k]() { answered[k] = client.sum(numberSets[k], sums[k]); });
+    for (std::thread& sender : senders)
+        sender.join();
+
+    for (size_t k = 0; k < numberSets.size(); k++) {
         // Create message with numbers
         std::stringstream ss;
-        for (size_t i = 0; i < numbers.size(); i++) {
-            ss << numbers[i];
-            if (i < numbers.size() - 1) ss << ",";
+        for (size_t i = 0; i < numberSets[k].size(); i++) {
+            ss << numberSets[k][i];
+            if (i < numberSets[k].size() - 1) ss << ",";
         }
-        std::string message = ss.str();
-        
-        std::cout << "Sending numbers: " << message << std::endl;
-        send(sock, message.c_str(), message.length(), 0);
-        
-        // Receive sum from server
-        memset(buffer, 0, sizeof(buffer));
-        read(sock, buffer, 1024);
-        std::cout << "Server calculated sum: " << buffer << std::endl;
+        std::cout << "Sending numbers: " << ss.str() << std::endl;
+        if (answered[k])
+            std::cout << "Server calculated sum: " << sums[k] << std::endl;
+        else
+            std::cout << "Server error!" << std::endl;
         std::cout << "---" << std::endl;
-        
-        sleep(1);
     }
 
+    // Throughput: threads sharing the pool (one request per connection at a time), then
+    // one connection of our own, one request at a time, pipelined, and pipelined in batches
+    printf("%-20s %7s %6s %10s %10s %10s %10s %7s\n", "mode", "window", "batch", "req/s", "p50 us", "p99 us",
+        "max us", "errors");
+    runPooledBenchmark(client, requests, threads, options.connectionsPerEndpoint * endpoints.size());
+    int sock = client.openConnection();
+    bool connected = sock >= 0 &&
+        runBenchmark(sock, "one at a time", requests, 1, 1) &&
+        runBenchmark(sock, "pipelined", requests, window, 1) &&
+        runBenchmark(sock, "pipelined + batched", requests, window, batch);
+    if (!connected) {
+        std::cerr << "Connection to data-service lost!" << std::endl;
+        return -1;
+    }
+    std::cout << "Connections opened: " << client.getConnectionsOpened() << ", failures: " << client.getFailures()
+              << std::endl;
+
     close(sock);
     return 0;
 }
@@ -0,0 +1,181 @@
+// Protocol.h
+// Length-prefixed binary framing shared by the data-service and the client-service
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/*
+* Every message is a frame: a fixed 12-byte header followed by `length` payload bytes.
+* All integers are little-endian, whatever the host byte order.
+*
+*   offset  size  field
+*   0       4     length      payload bytes after the header
+*   4       1     version     PROTOCOL_VERSION
+*   5       1     type        MessageType
+*   6       2     reserved    0
+*   8       4     requestId   chosen by the client, copied into the response
+*
+* Payloads:
+* - SUM_REQUEST: packed int32 values (length is a multiple of 4)
+* - SUM_RESPONSE: one int64, the sum (no overflow for up to 2^32 values)
+* - ERROR_RESPONSE: a human-readable message
+*
+* Since the length comes first, a receiver knows how many bytes to wait for, so a frame
+* may arrive split over several reads or together with other frames in one read.
+*/
+
+namespace protocol {
+
+const uint8_t PROTOCOL_VERSION = 1;
+const size_t HEADER_SIZE = 12;
+const uint32_t MAX_PAYLOAD = 16 * 1024 * 1024; // Larger lengths are treated as garbage
+
+enum MessageType : uint8_t {
+    SUM_REQUEST = 1,
+    SUM_RESPONSE = 2,
+    ERROR_RESPONSE = 3
+};
+
+struct FrameHeader {
+    uint32_t length;
+    uint8_t version;
+    uint8_t type;
+    uint32_t requestId;
+};
+
+// A decoded frame. The payload points into the buffer it was decoded from.
+struct Frame {
+    FrameHeader header;
+    const char* payload;
+
+    size_t size() const { return HEADER_SIZE + header.length; }
+    size_t valueCount() const { return header.length / 4; }
+};
+
+enum DecodeStatus {
+    NEED_MORE, // Not a whole frame yet: wait for more bytes
+    COMPLETE,  // A frame was decoded
+    INVALID    // Not a frame of this protocol: the stream cannot be resynchronized
+};
+
+// Little-endian loads and stores. Byte shifts instead of casts keep them independent of
+// alignment and host byte order; compilers turn them into single moves on x86.
+inline uint32_t loadLE32(const char* p) {
+    const unsigned char* b = (const unsigned char*)p;
+    return (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+inline uint64_t loadLE64(const char* p) {
+    return (uint64_t)loadLE32(p) | (uint64_t)loadLE32(p + 4) << 32;
+}
+
+inline void storeLE32(char* p, uint32_t value) {
+    p[0] = (char)value;
+    p[1] = (char)(value >> 8);
+    p[2] = (char)(value >> 16);
+    p[3] = (char)(value >> 24);
+}
+
+inline void storeLE64(char* p, uint64_t value) {
+    storeLE32(p, (uint32_t)value);
+    storeLE32(p + 4, (uint32_t)(value >> 32));
+}
+
+inline int32_t valueAt(const Frame& frame, size_t i) {
+    return (int32_t)loadLE32(frame.payload + 4 * i);
+}
+
+// Append a header for a payload of `length` bytes; the caller appends the payload
+inline void appendHeader(std::string& out, MessageType type, uint32_t requestId, uint32_t length) {
+    char header[HEADER_SIZE] = {};
+    storeLE32(header, length);
+    header[4] = (char)PROTOCOL_VERSION;
+    header[5] = (char)type;
+    storeLE32(header + 8, requestId);
+    out.append(header, HEADER_SIZE);
+}
+
+inline void appendSumRequest(std::string& out, uint32_t requestId, const int32_t* values, size_t count) {
+    size_t start = out.size();
+    appendHeader(out, SUM_REQUEST, requestId, (uint32_t)(4 * count));
+    out.resize(start + HEADER_SIZE + 4 * count);
+    char* payload = &out[start + HEADER_SIZE];
+    for (size_t i = 0; i < count; i++)
+        storeLE32(payload + 4 * i, (uint32_t)values[i]);
+}
+
+inline void appendSumRequest(std::string& out, uint32_t requestId, const std::vector<int>& values) {
+    appendSumRequest(out, requestId, values.data(), values.size());
+}
+
+inline void appendSumResponse(std::string& out, uint32_t requestId, int64_t sum) {
+    char payload[8];
+    storeLE64(payload, (uint64_t)sum);
+    appendHeader(out, SUM_RESPONSE, requestId, sizeof(payload));
+    out.append(payload, sizeof(payload));
+}
+
+inline void appendError(std::string& out, uint32_t requestId, const char* message) {
+    size_t length = strlen(message);
+    appendHeader(out, ERROR_RESPONSE, requestId, (uint32_t)length);
+    out.append(message, length);
+}
+
+inline int64_t sumOf(const Frame& response) {
+    return (int64_t)loadLE64(response.payload);
+}
+
+// Decode the frame at the start of data[0, size). Stateless: the caller keeps the
+// bytes of an incomplete frame and calls again when more have arrived.
+inline DecodeStatus decodeFrame(const char* data, size_t size, Frame& frame) {
+    if (size < HEADER_SIZE)
+        return NEED_MORE;
+    frame.header.length = loadLE32(data);
+    frame.header.version = (uint8_t)data[4];
+    frame.header.type = (uint8_t)data[5];
+    frame.header.requestId = loadLE32(data + 8);
+    if (frame.header.version != PROTOCOL_VERSION || frame.header.length > MAX_PAYLOAD)
+        return INVALID;
+    if (size < HEADER_SIZE + frame.header.length)
+        return NEED_MORE;
+    frame.payload = data + HEADER_SIZE;
+    return COMPLETE;
+}
+
+// Streaming decoder for a receiver that reads into its own buffers: feed() whatever
+// read() returned, then take frames with next() until it returns NEED_MORE. A frame's
+// payload stays valid until the next call to feed().
+class FrameDecoder {
+private:
+    std::string buffer;
+    size_t offset = 0; // Start of the first frame not returned yet
+
+public:
+    void feed(const char* data, size_t size) {
+        // Drop the frames already returned before the buffer grows
+        if (offset > 0) {
+            buffer.erase(0, offset);
+            offset = 0;
+        }
+        buffer.append(data, size);
+    }
+
+    DecodeStatus next(Frame& frame) {
+        DecodeStatus status = decodeFrame(buffer.data() + offset, buffer.size() - offset, frame);
+        if (status == COMPLETE)
+            offset += frame.size();
+        return status;
+    }
+
+    size_t buffered() const { return buffer.size() - offset; }
+};
+
+} // namespace protocol
+
+#endif
@@ -0,0 +1,320 @@
+// EventLoop.h
+// Non-blocking, edge-triggered epoll reactor for the data-service
+
+#ifndef EVENTLOOP_H
+#define EVENTLOOP_H
+
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <stdexcept>
+#include "RequestHandler.h"
+#include "ReceiveBuffer.h"
+
+/*
+* One EventLoop runs on one thread and owns everything it touches: its listening
+* sockets, its epoll instance and its connections. Nothing is shared between loops
+* except the handlers, so there are no locks on the request path.
+*
+* - Every loop binds its own listening socket to the same port with SO_REUSEPORT,
+*   and the kernel spreads new connections over the loops. Run one loop per core.
+* - A loop may listen on several ports, one per protocol: connections accepted on a
+*   port are served by the handler given for that port.
+* - Sockets are non-blocking and registered once, edge-triggered, for both input and
+*   output. After an edge the loop reads (or accepts, or writes) until EAGAIN, since
+*   the same readiness is not reported twice.
+* - Requests may arrive split over several reads or several in one read; the bytes of
+*   an incomplete request stay in the connection's input buffer.
+* - Nothing is allocated per request: sockets are read straight into the connection's
+*   ReceiveBuffer, the handler parses the bytes in place, and responses are appended to
+*   an output buffer reserved when the connection is accepted and reused after every
+*   write.
+* - A connection whose client does not read its responses stops being read once
+*   MAX_PENDING_OUTPUT bytes are queued, and is read again when they have been sent.
+*/
+
+class EventLoop {
+private:
+    static const int MAX_EVENTS = 1024;
+    static const size_t INPUT_CAPACITY = 16 * 1024;
+    static const size_t OUTPUT_CAPACITY = 16 * 1024;
+    static const size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+
+    struct Listener {
+        int fd;
+        RequestHandler* handler;
+    };
+
+    struct Connection {
+        int fd;
+        RequestHandler* handler;
+        ReceiveBuffer input; // Received bytes the handler has not consumed yet
+        std::string output;  // Responses not written yet
+        size_t written = 0;  // Bytes of output already written
+        bool readPaused = false;
+        bool closeWhenFlushed = false; // The client is done or the stream is corrupt
+
+        Connection(int socket, RequestHandler* requestHandler)
+            : fd(socket), handler(requestHandler), input(INPUT_CAPACITY, requestHandler->maxRequestSize()) {
+            output.reserve(OUTPUT_CAPACITY);
+        }
+    };
+
+    std::vector<Listener> listeners;
+    int epollFd = -1;
+    int wakeFd = -1; // eventfd that stop() writes to
+    std::vector<std::unique_ptr<Connection>> connections; // Indexed by file descriptor
+    size_t openConnections = 0;
+    size_t syscalls = 0;
+    std::atomic<bool> stopping{false};
+
+    static void fail(const char* what) {
+        throw std::runtime_error(std::string(what) + ": " + strerror(errno));
+    }
+
+    void watch(int fd, uint32_t events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = fd;
+        syscalls++;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+            fail("epoll_ctl");
+    }
+
+    void acceptAll(const Listener& listener) {
+        while (true) {
+            syscalls++;
+            int fd = accept4(listener.fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                if (errno == EMFILE || errno == ENFILE)
+                    std::cerr << "Accepting connection failed: too many open files" << std::endl;
+                return; // EAGAIN: nothing left to accept
+            }
+
+            // Responses are small and should not wait for Nagle's algorithm
+            int one = 1;
+            syscalls++;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            if ((size_t)fd >= connections.size())
+                connections.resize(fd + 1);
+            connections[fd].reset(new Connection(fd, listener.handler));
+            openConnections++;
+            watch(fd, EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET);
+        }
+    }
+
+    void close(Connection& connection) {
+        int fd = connection.fd;
+        syscalls += 2;
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+        connections[fd].reset();
+        openConnections--;
+    }
+
+    // Write the responses queued and close the connection once all of them are out.
+    // What does not fit in the socket buffer now is written on EPOLLOUT, which closes.
+    void closeWhenFlushed(Connection& connection) {
+        connection.closeWhenFlushed = true;
+        if (writeAll(connection) && connection.output.empty())
+            close(connection);
+    }
+
+    // Read until EAGAIN and hand every complete request to the handler.
+    // Returns false when the connection was closed or is closing.
+    bool readAll(Connection& connection) {
+        while (!connection.readPaused && !connection.closeWhenFlushed) {
+            size_t space = connection.input.prepareWrite();
+            if (space == 0) {
+                // A single request larger than the handler accepts
+                close(connection);
+                return false;
+            }
+            syscalls++;
+            ssize_t bytesRead = read(connection.fd, connection.input.writePointer(), space);
+            if (bytesRead < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return true;
+                close(connection);
+                return false;
+            }
+            if (bytesRead == 0) {
+                // The client is done: send what is left, then close
+                closeWhenFlushed(connection);
+                return false;
+            }
+
+            connection.input.commit(bytesRead);
+            size_t consumed = connection.handler->onData(connection.input.readPointer(), connection.input.readable(),
+                connection.output);
+            if (consumed == RequestHandler::CLOSE_CONNECTION) {
+                // Corrupt stream: send the error the handler wrote, then close
+                closeWhenFlushed(connection);
+                return false;
+            }
+            connection.input.consume(consumed);
+            if (!writeAll(connection))
+                return false;
+            if (connection.output.size() - connection.written > MAX_PENDING_OUTPUT)
+                connection.readPaused = true;
+        }
+        return true;
+    }
+
+    // Write until the output is empty or EAGAIN. Returns false when the connection
+    // was closed.
+    bool writeAll(Connection& connection) {
+        while (connection.written < connection.output.size()) {
+            syscalls++;
+            ssize_t sent = send(connection.fd, connection.output.data() + connection.written,
+                connection.output.size() - connection.written, MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return true;
+                close(connection);
+                return false;
+            }
+            connection.written += sent;
+        }
+        connection.output.clear();
+        connection.written = 0;
+        return true;
+    }
+
+public:
+    EventLoop() {
+        if ((epollFd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+            fail("epoll_create1");
+        if ((wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+            fail("eventfd");
+        watch(wakeFd, EPOLLIN);
+    }
+
+    // Accept connections on the port and serve them with the handler. Listens right
+    // away, so a bind error is reported to the caller.
+    void listen(int port, RequestHandler& handler, int backlog = SOMAXCONN) {
+        // Creating socket file descriptor
+        int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0)
+            fail("Socket creation error");
+        listeners.push_back(Listener{listenFd, &handler});
+
+        // Every loop listens on the same port; the kernel balances connections
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)
+            fail("SO_REUSEPORT");
+
+        // Assigning address and port
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = htons(port);
+        if (bind(listenFd, (sockaddr*)&address, sizeof(address)) < 0)
+            fail("Binding error");
+        if (::listen(listenFd, backlog) < 0)
+            fail("Listening error");
+        watch(listenFd, EPOLLIN | EPOLLET);
+    }
+
+    ~EventLoop() {
+        for (std::unique_ptr<Connection>& connection : connections)
+            if (connection)
+                ::close(connection->fd);
+        ::close(wakeFd);
+        ::close(epollFd);
+        for (Listener& listener : listeners)
+            ::close(listener.fd);
+    }
+
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    size_t getOpenConnections() const { return openConnections; }
+
+    // System calls made by run(), to compare with UringLoop
+    size_t getSyscalls() const { return syscalls; }
+
+    // Serve until stop() is called
+    void run() {
+        epoll_event events[MAX_EVENTS];
+        while (!stopping.load(std::memory_order_acquire)) {
+            syscalls++;
+            int ready = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+            if (ready < 0) {
+                if (errno == EINTR)
+                    continue;
+                fail("epoll_wait");
+            }
+
+            for (int i = 0; i < ready; i++) {
+                int fd = events[i].data.fd;
+                if (fd == wakeFd)
+                    continue;
+                bool accepted = false;
+                for (const Listener& listener : listeners) {
+                    if (listener.fd == fd) {
+                        acceptAll(listener);
+                        accepted = true;
+                    }
+                }
+                if (accepted)
+                    continue;
+
+                // Events for a connection closed earlier in this batch are stale
+                Connection* connection = (size_t)fd < connections.size() ? connections[fd].get() : nullptr;
+                if (!connection)
+                    continue;
+                uint32_t flags = events[i].events;
+                if (flags & EPOLLERR) {
+                    close(*connection);
+                    continue;
+                }
+                if (flags & EPOLLOUT) {
+                    if (!writeAll(*connection))
+                        continue;
+                    if (connection->closeWhenFlushed) {
+                        if (connection->output.empty())
+                            close(*connection);
+                        continue;
+                    }
+                    if (connection->readPaused && connection->output.empty()) {
+                        // Everything queued was sent: take the input the kernel kept for us
+                        connection->readPaused = false;
+                        flags |= EPOLLIN;
+                    }
+                }
+                // On a hang-up, read what is left: the read returns 0 and closes
+                if (flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP))
+                    readAll(*connection);
+            }
+        }
+    }
+
+    // Thread-safe: makes run() return after the events it is handling
+    void stop() {
+        stopping.store(true, std::memory_order_release);
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+};
+
+#endif
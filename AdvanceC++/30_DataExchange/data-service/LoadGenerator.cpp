@@ -0,0 +1,260 @@
+// LoadGenerator.cpp
+// Opens many concurrent connections to the data-service and measures throughput
+// and latency of the text or the binary protocol
+//
+// Usage: LoadGenerator [host] [port] [connections] [seconds] [threads] [text|binary]
+// Defaults: 127.0.0.1 8080 1000 10 (one thread per core) text
+// The binary protocol is served on its own port (8081 by default).
+//
+// Every connection sends one request, waits for the response and sends the next
+// (a closed loop), so the offered load grows with the number of connections.
+// Requests are only timed once every connection is established.
+
+#include <iostream>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "../common/Protocol.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// The same request is sent over and over: 1 + 2 + ... + 10 = 55
+static const std::vector<int> NUMBERS = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+static const int64_t SUM = 55;
+static bool binary = false;
+static std::string request;
+
+static std::atomic<size_t> connected{0};
+static std::atomic<bool> measuring{false};
+static std::atomic<bool> stopping{false};
+
+struct Connection {
+    int fd;
+    bool connected = false;
+    bool waiting = false; // A request is in flight
+    Clock::time_point sentAt;
+    std::string input;
+};
+
+struct WorkerResult {
+    std::vector<double> latencyUs;
+    size_t failedConnections = 0;
+    size_t errors = 0; // Wrong responses and connections lost while measuring
+};
+
+// Send the request. Small enough to always fit in the empty socket buffer.
+bool sendRequest(Connection& connection) {
+    connection.sentAt = Clock::now();
+    connection.waiting = true;
+    return send(connection.fd, request.data(), request.size(), MSG_NOSIGNAL) == (ssize_t)request.size();
+}
+
+// Length of the response at the start of the input, 0 while it is incomplete. Sets
+// valid to whether it is the expected answer.
+size_t takeResponse(const std::string& input, bool& valid) {
+    if (binary) {
+        protocol::Frame frame;
+        protocol::DecodeStatus status = protocol::decodeFrame(input.data(), input.size(), frame);
+        if (status == protocol::NEED_MORE)
+            return 0;
+        if (status == protocol::INVALID) {
+            valid = false;
+            return input.size();
+        }
+        valid = frame.header.type == protocol::SUM_RESPONSE && frame.header.requestId == 1 &&
+            frame.header.length == 8 && protocol::sumOf(frame) == SUM;
+        return frame.size();
+    }
+    size_t newline = input.find('\n');
+    if (newline == std::string::npos)
+        return 0;
+    valid = input.compare(0, newline, std::to_string(SUM)) == 0;
+    return newline + 1;
+}
+
+void worker(sockaddr_in address, int connectionCount, WorkerResult& result) {
+    int epollFd = epoll_create1(0);
+    std::vector<Connection> connections(connectionCount);
+    for (int i = 0; i < connectionCount; i++) {
+        Connection& connection = connections[i];
+        connection.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        int one = 1;
+        setsockopt(connection.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (connection.fd < 0 || (connect(connection.fd, (sockaddr*)&address, sizeof(address)) < 0 && errno != EINPROGRESS)) {
+            result.failedConnections++;
+            connected++;
+            continue;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.u32 = i;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, connection.fd, &event);
+    }
+
+    auto fail = [&](Connection& connection) {
+        if (!connection.connected) {
+            result.failedConnections++;
+            connected++;
+        } else if (measuring.load()) {
+            result.errors++;
+        }
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, connection.fd, nullptr);
+        close(connection.fd);
+        connection.fd = -1;
+    };
+
+    bool started = false;
+    std::vector<epoll_event> events(1024);
+    char buffer[4096];
+    while (!stopping.load()) {
+        // Once all threads have connected, start the request loop of every connection
+        if (!started && measuring.load()) {
+            started = true;
+            for (Connection& connection : connections)
+                if (connection.fd >= 0 && connection.connected && !sendRequest(connection))
+                    fail(connection);
+        }
+
+        int ready = epoll_wait(epollFd, events.data(), events.size(), 10);
+        for (int k = 0; k < ready; k++) {
+            Connection& connection = connections[events[k].data.u32];
+            if (connection.fd < 0)
+                continue;
+            uint32_t flags = events[k].events;
+            if (!connection.connected && (flags & (EPOLLOUT | EPOLLERR))) {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                getsockopt(connection.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+                if (error != 0 || (flags & EPOLLERR)) {
+                    fail(connection);
+                    continue;
+                }
+                connection.connected = true;
+                connected++;
+                if (started && !sendRequest(connection)) {
+                    fail(connection);
+                    continue;
+                }
+            }
+            if (!(flags & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)))
+                continue;
+
+            // Read until EAGAIN (edge-triggered), then answer every complete response
+            bool open = true;
+            while (true) {
+                ssize_t bytesRead = read(connection.fd, buffer, sizeof(buffer));
+                if (bytesRead > 0) {
+                    connection.input.append(buffer, bytesRead);
+                    continue;
+                }
+                open = bytesRead < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+                break;
+            }
+            size_t length;
+            bool valid = true;
+            while ((length = takeResponse(connection.input, valid)) > 0) {
+                auto now = Clock::now();
+                if (!valid)
+                    result.errors++;
+                connection.input.erase(0, length);
+                connection.waiting = false;
+                if (stopping.load())
+                    break;
+                result.latencyUs.push_back(std::chrono::duration<double, std::micro>(now - connection.sentAt).count());
+                if (!sendRequest(connection)) {
+                    open = false;
+                    break;
+                }
+            }
+            if (!open)
+                fail(connection);
+        }
+    }
+
+    for (Connection& connection : connections)
+        if (connection.fd >= 0)
+            close(connection.fd);
+    close(epollFd);
+}
+
+double percentile(std::vector<double>& sorted, double p) {
+    if (sorted.empty())
+        return 0.0;
+    return sorted[(size_t)(p * (sorted.size() - 1) + 0.5)];
+}
+
+int main(int argc, char* argv[]) {
+    const char* host = argc > 1 ? argv[1] : "127.0.0.1";
+    int port = argc > 2 ? atoi(argv[2]) : 8080;
+    int connectionCount = argc > 3 ? atoi(argv[3]) : 1000;
+    int seconds = argc > 4 ? atoi(argv[4]) : 10;
+    int threadCount = argc > 5 ? atoi(argv[5]) : (int)std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::max(1, std::min(threadCount, connectionCount));
+    binary = argc > 6 && std::string(argv[6]) == "binary";
+    if (binary) {
+        protocol::appendSumRequest(request, 1, NUMBERS);
+    } else {
+        for (size_t i = 0; i < NUMBERS.size(); i++)
+            request += std::to_string(NUMBERS[i]) + (i + 1 < NUMBERS.size() ? "," : "\n");
+    }
+
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &address.sin_addr) != 1) {
+        std::cerr << "Invalid address: " << host << std::endl;
+        return -1;
+    }
+
+    // Spread the connections over the threads, one epoll instance each
+    std::vector<WorkerResult> results(threadCount);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; t++) {
+        int share = connectionCount / threadCount + (t < connectionCount % threadCount ? 1 : 0);
+        threads.emplace_back(worker, address, share, std::ref(results[t]));
+    }
+
+    // Wait for the connections (failed ones are counted too), at most 30 seconds
+    auto connectStart = Clock::now();
+    while (connected.load() < (size_t)connectionCount && Clock::now() - connectStart < std::chrono::seconds(30))
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    double connectMs = std::chrono::duration<double, std::milli>(Clock::now() - connectStart).count();
+
+    auto start = Clock::now();
+    measuring = true;
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stopping = true;
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    for (std::thread& thread : threads)
+        thread.join();
+
+    std::vector<double> latency;
+    size_t failedConnections = 0, errors = 0;
+    for (WorkerResult& result : results) {
+        latency.insert(latency.end(), result.latencyUs.begin(), result.latencyUs.end());
+        failedConnections += result.failedConnections;
+        errors += result.errors;
+    }
+    std::sort(latency.begin(), latency.end());
+
+    printf("connections: %d (%zu failed, connected in %.0f ms), threads: %d, protocol: %s\n",
+        connectionCount, failedConnections, connectMs, threadCount, binary ? "binary" : "text");
+    printf("requests:    %zu in %.1f s = %.0f req/s, %zu errors\n",
+        latency.size(), elapsed, latency.size() / elapsed, errors);
+    printf("latency us:  p50 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+        percentile(latency, 0.50), percentile(latency, 0.99), percentile(latency, 0.999), percentile(latency, 1.0));
+    return 0;
+}
@@ -0,0 +1,142 @@
+// ProtocolBenchmark.cpp
+// Compares the text protocol (SumHandler) with the binary framing (BinarySumHandler)
+// without sockets, so only the encoding and the parsing are measured
+//
+// Usage: ProtocolBenchmark [requests per size]
+//
+// For each request size (number of integers per request) it reports:
+// - bytes: request size on the wire
+// - encode: client-side cost of building one request
+// - handle: server-side cost of one request (decode, sum, encode the response)
+// - MB/s: request bytes the handler gets through per second
+// - allocs: heap allocations per request while handling (0 is the goal)
+//
+// It also feeds the binary stream through FrameDecoder in random-sized chunks, as
+// TCP may deliver it, and checks that every frame comes out whole.
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "RequestHandler.h"
+
+typedef std::chrono::steady_clock Clock;
+
+// Every heap allocation of the program is counted
+static size_t allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    if (void* p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+double nsPerItem(Clock::time_point start, size_t items) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / items;
+}
+
+// Text request as the client-service built it before the binary protocol
+void appendTextRequest(std::string& out, const std::vector<int>& values) {
+    for (size_t i = 0; i < values.size(); i++) {
+        out += std::to_string(values[i]);
+        out += i + 1 < values.size() ? ',' : '\n';
+    }
+}
+
+// Sum of every SUM_RESPONSE in a stream fed in random-sized chunks
+int64_t decodeInChunks(const std::string& stream, std::mt19937& rng, size_t& frames) {
+    protocol::FrameDecoder decoder;
+    protocol::Frame frame;
+    int64_t total = 0;
+    std::uniform_int_distribution<size_t> chunk(1, 1500); // Up to one Ethernet MTU
+    for (size_t offset = 0; offset < stream.size();) {
+        size_t size = std::min(chunk(rng), stream.size() - offset);
+        decoder.feed(stream.data() + offset, size);
+        offset += size;
+        while (decoder.next(frame) == protocol::COMPLETE) {
+            total += protocol::sumOf(frame);
+            frames++;
+        }
+    }
+    return total;
+}
+
+int main(int argc, char* argv[]) {
+    size_t requests = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> value(-1000, 1000);
+    std::atomic<size_t> counter{0};
+    SumHandler textHandler(counter);
+    BinarySumHandler binaryHandler(counter);
+
+    printf("%-8s %-7s %10s %12s %12s %10s %8s\n", "values", "format", "bytes", "encode ns", "handle ns", "MB/s",
+        "allocs");
+    bool valid = true;
+    for (size_t count : {1, 5, 16, 64, 256, 1024}) {
+        size_t n = std::max<size_t>(1, requests * 16 / (count + 15)); // Similar total work per size
+        std::vector<std::vector<int>> sets(n, std::vector<int>(count));
+        int64_t expected = 0;
+        for (std::vector<int>& set : sets)
+            for (int& x : set) {
+                x = value(rng);
+                expected += x;
+            }
+
+        // Client side: encode every request into one stream
+        std::string text, binary;
+        auto start = Clock::now();
+        for (const std::vector<int>& set : sets)
+            appendTextRequest(text, set);
+        double textEncode = nsPerItem(start, n);
+        start = Clock::now();
+        for (size_t k = 0; k < n; k++)
+            protocol::appendSumRequest(binary, (uint32_t)k, sets[k]);
+        double binaryEncode = nsPerItem(start, n);
+
+        // Server side: one onData() call over the whole stream, into output buffers
+        // reserved up front as the event loop does
+        std::string textOut, binaryOut;
+        textOut.reserve(n * 8);
+        binaryOut.reserve(n * (protocol::HEADER_SIZE + 8));
+        size_t before = allocations;
+        start = Clock::now();
+        size_t textConsumed = textHandler.onData(text.data(), text.size(), textOut);
+        double textHandle = nsPerItem(start, n);
+        double textAllocs = (double)(allocations - before) / n;
+        before = allocations;
+        start = Clock::now();
+        size_t binaryConsumed = binaryHandler.onData(binary.data(), binary.size(), binaryOut);
+        double binaryHandle = nsPerItem(start, n);
+        double binaryAllocs = (double)(allocations - before) / n;
+
+        // Both must have answered every request with the right sums
+        int64_t textTotal = 0;
+        for (size_t pos = 0; pos < textOut.size(); pos = textOut.find('\n', pos) + 1)
+            textTotal += strtoll(textOut.c_str() + pos, nullptr, 10);
+        size_t frames = 0;
+        int64_t binaryTotal = decodeInChunks(binaryOut, rng, frames);
+        if (textConsumed != text.size() || binaryConsumed != binary.size() || textTotal != expected ||
+            binaryTotal != expected || frames != n) {
+            printf("MISMATCH for %zu values: text %lld, binary %lld (%zu frames), expected %lld\n", count,
+                (long long)textTotal, (long long)binaryTotal, frames, (long long)expected);
+            valid = false;
+        }
+
+        printf("%-8zu %-7s %10.1f %12.1f %12.1f %10.1f %8.2f\n", count, "text", (double)text.size() / n,
+            textEncode, textHandle, text.size() / (textHandle * n) * 1e3, textAllocs);
+        printf("%-8s %-7s %10.1f %12.1f %12.1f %10.1f %8.2f\n", "", "binary", (double)binary.size() / n,
+            binaryEncode, binaryHandle, binary.size() / (binaryHandle * n) * 1e3, binaryAllocs);
+    }
+
+    printf("\nresponses decoded from random-sized chunks: %s\n", valid ? "ok" : "FAILED");
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+// ReceiveBuffer.h
+// Per-connection receive buffer that the socket reads into and the handler parses in place
+
+#ifndef RECEIVEBUFFER_H
+#define RECEIVEBUFFER_H
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+/*
+* A ring buffer of bytes received and not consumed yet, allocated once per connection:
+* read() writes straight into its free space and the handler parses the unread bytes
+* where they are, so a request is never copied between buffers.
+*
+* A handler needs each request in one piece, so instead of wrapping around, the ring
+* moves its unread bytes (at most one incomplete request) back to the front when the
+* free space runs out at the end. The buffer only grows for a request larger than its
+* capacity, up to maxCapacity.
+*/
+
+class ReceiveBuffer {
+private:
+    std::unique_ptr<char[]> data;
+    size_t capacity;
+    size_t maxCapacity;
+    size_t head = 0; // First unread byte
+    size_t tail = 0; // End of the unread bytes
+
+public:
+    ReceiveBuffer(size_t initialCapacity, size_t maximumCapacity)
+        : data(new char[initialCapacity]), capacity(initialCapacity), maxCapacity(maximumCapacity) {}
+
+    const char* readPointer() const { return data.get() + head; }
+    size_t readable() const { return tail - head; }
+
+    // Mark bytes as handled
+    void consume(size_t size) {
+        head += size;
+        if (head == tail)
+            head = tail = 0; // Empty: start over at the front, no move needed
+    }
+
+    // Make room after the unread bytes and return how much there is: 0 when the
+    // buffer is full of one request and may not grow any more
+    size_t prepareWrite() {
+        if (tail < capacity)
+            return capacity - tail;
+        if (head > 0) {
+            memmove(data.get(), data.get() + head, tail - head);
+            tail -= head;
+            head = 0;
+        } else if (capacity < maxCapacity) {
+            size_t grown = capacity * 2 < maxCapacity ? capacity * 2 : maxCapacity;
+            std::unique_ptr<char[]> larger(new char[grown]);
+            memcpy(larger.get(), data.get(), tail);
+            data.swap(larger);
+            capacity = grown;
+        }
+        return capacity - tail;
+    }
+
+    char* writePointer() { return data.get() + tail; }
+
+    // Mark bytes written at writePointer() as received
+    void commit(size_t size) { tail += size; }
+};
+
+#endif
@@ -0,0 +1,150 @@
+// RequestHandler.h
+// The data-service protocol, separate from the socket code that moves the bytes
+
+#ifndef REQUESTHANDLER_H
+#define REQUESTHANDLER_H
+
+#include <string>
+#include <charconv>
+#include <cstring>
+#include <atomic>
+#include <cstdint>
+#include "../common/Protocol.h"
+
+// Turns the bytes received on a connection into response bytes. The event loop owns
+// the buffers: it passes everything received and not consumed yet, and keeps the
+// bytes of an incomplete request for the next call. One handler serves every
+// connection of a loop, so it must not keep per-connection state.
+class RequestHandler {
+public:
+    // Returned by onData() when the stream is corrupt: the loop sends the output
+    // appended so far and closes the connection
+    static const size_t CLOSE_CONNECTION = SIZE_MAX;
+
+    virtual ~RequestHandler() = default;
+
+    // Largest request the handler accepts: the most a connection's receive buffer
+    // grows to while waiting for the end of one request
+    virtual size_t maxRequestSize() const = 0;
+
+    // Handle the complete requests at the start of data[0, size), append their
+    // responses to out, and return the number of bytes consumed
+    virtual size_t onData(const char* data, size_t size, std::string& out) = 0;
+};
+
+// Text protocol: a request is a line of comma-separated integers ("1,2,3\n") and the
+// response is their sum on a line of its own ("6\n"). A line that is not a list of
+// integers gets "error\n". A line of MAX_LINE bytes or more gets "error: line too long\n"
+// and the connection is closed, so a client that never ends its line cannot make the
+// server buffer more than MAX_LINE bytes for it.
+//
+// Lines are parsed where they lie in the receive buffer: memchr (vectorized in the C
+// library) finds the end of the line and std::from_chars converts each number, then
+// std::to_chars writes the sum into the output buffer. Nothing is allocated per
+// request as long as the output buffer has room.
+class SumHandler : public RequestHandler {
+private:
+    static const size_t MAX_LINE = 16 * 1024;
+
+    std::atomic<size_t>& requests; // Shared by the loops, for the statistics
+
+    // Sum the numbers of the line [p, end). Spaces around a number, a '+' sign and a
+    // trailing comma are accepted, as std::stoi did; anything else is an error.
+    static bool parseLine(const char* p, const char* end, int64_t& sum) {
+        if (p < end && end[-1] == '\r')
+            end--; // Line ending of telnet-style clients
+        sum = 0;
+        while (p < end) {
+            while (p < end && *p == ' ')
+                p++;
+            if (p + 1 < end && *p == '+' && p[1] >= '0' && p[1] <= '9')
+                p++;
+            int value;
+            std::from_chars_result result = std::from_chars(p, end, value);
+            if (result.ec != std::errc())
+                return false; // Not a number, or out of the int range
+            sum += value;
+            p = result.ptr;
+            while (p < end && *p == ' ')
+                p++;
+            if (p < end && *p++ != ',')
+                return false;
+        }
+        return true;
+    }
+
+public:
+    explicit SumHandler(std::atomic<size_t>& requestCounter) : requests(requestCounter) {}
+
+    size_t maxRequestSize() const override { return MAX_LINE; }
+
+    size_t onData(const char* data, size_t size, std::string& out) override {
+        size_t consumed = 0;
+        size_t handled = 0;
+        while (const char* newline = (const char*)memchr(data + consumed, '\n', size - consumed)) {
+            const char* line = data + consumed;
+            consumed = newline - data + 1;
+            handled++;
+
+            int64_t sum;
+            if (!parseLine(line, newline, sum)) {
+                out.append("error\n", 6);
+                continue;
+            }
+            char digits[24];
+            char* last = std::to_chars(digits, digits + sizeof(digits) - 1, sum).ptr;
+            *last++ = '\n';
+            out.append(digits, last - digits);
+        }
+        requests.fetch_add(handled, std::memory_order_relaxed);
+        if (size - consumed >= MAX_LINE) {
+            out.append("error: line too long\n");
+            return CLOSE_CONNECTION;
+        }
+        return consumed;
+    }
+};
+
+// Binary protocol (common/Protocol.h): SUM_REQUEST frames of packed int32 values get a
+// SUM_RESPONSE with their int64 sum and the same request id. A well-framed request of
+// another type gets an ERROR_RESPONSE; bytes that are not a frame close the connection.
+class BinarySumHandler : public RequestHandler {
+private:
+    std::atomic<size_t>& requests;
+
+public:
+    explicit BinarySumHandler(std::atomic<size_t>& requestCounter) : requests(requestCounter) {}
+
+    size_t maxRequestSize() const override { return protocol::HEADER_SIZE + protocol::MAX_PAYLOAD; }
+
+    size_t onData(const char* data, size_t size, std::string& out) override {
+        size_t consumed = 0;
+        size_t handled = 0;
+        protocol::Frame frame;
+        while (true) {
+            protocol::DecodeStatus status = protocol::decodeFrame(data + consumed, size - consumed, frame);
+            if (status == protocol::NEED_MORE)
+                break;
+            if (status == protocol::INVALID) {
+                protocol::appendError(out, 0, "invalid frame");
+                consumed = CLOSE_CONNECTION;
+                break;
+            }
+            consumed += frame.size();
+            handled++;
+
+            if (frame.header.type != protocol::SUM_REQUEST || frame.header.length % 4 != 0) {
+                protocol::appendError(out, frame.header.requestId, "expected a SUM_REQUEST of int32 values");
+                continue;
+            }
+            int64_t sum = 0;
+            for (size_t i = 0; i < frame.valueCount(); i++)
+                sum += protocol::valueAt(frame, i);
+            protocol::appendSumResponse(out, frame.header.requestId, sum);
+        }
+        requests.fetch_add(handled, std::memory_order_relaxed);
+        return consumed;
+    }
+};
+
+#endif
@@ -0,0 +1,632 @@
+// UringLoop.h
+// io_uring backend for the data-service: the same loop as EventLoop.h, with the
+// socket operations submitted to the kernel in batches instead of one syscall each
+
+#ifndef URINGLOOP_H
+#define URINGLOOP_H
+
+#include <iostream>
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <stdexcept>
+#include "RequestHandler.h"
+#include "ReceiveBuffer.h"
+
+/*
+* Serves the same handlers as EventLoop with the same threading model (one loop per
+* thread, SO_REUSEPORT listeners, nothing shared), but drives the sockets through an
+* io_uring instead of epoll plus read/send calls. Linux 6.0 or later; the ring is set
+* up with raw syscalls, liburing is not needed.
+*
+* - Multishot accept: one submission per listener accepts every connection.
+* - Multishot recv into a provided buffer ring: one submission per connection receives
+*   every message, into buffers registered with the kernel once. The handler parses a
+*   message straight from the ring buffer; only the bytes of an incomplete request are
+*   copied into the connection's ReceiveBuffer. A recv that finds no free buffer ends;
+*   the connection is re-armed after the batch, once the buffers are back in the ring.
+* - Responses are sent with IORING_OP_SEND, one send in flight per connection; the
+*   responses handled while it is in flight go out with the next one.
+* - Everything submitted while handling a batch of completions goes to the kernel in
+*   the single io_uring_enter() that also waits for the next completions.
+*
+* A connection is freed only when no operation using it is in flight: closing cancels
+* its operations and waits for their completions.
+*/
+
+class UringLoop {
+private:
+    static const unsigned RING_ENTRIES = 4096;
+    static const unsigned BUFFER_COUNT = 1024; // Power of two
+    static const unsigned BUFFER_SIZE = 4096;
+    static const uint16_t BUFFER_GROUP = 0;
+    static const size_t INPUT_CAPACITY = 16 * 1024;
+    static const size_t OUTPUT_CAPACITY = 16 * 1024;
+    static const size_t MAX_PENDING_OUTPUT = 4 * 1024 * 1024;
+
+    // Operation kinds, in the upper half of user_data; the lower half is the fd or
+    // the listener index
+    enum Operation : uint64_t { ACCEPT = 1, RECV, SEND, CANCEL, WAKE };
+
+    struct Listener {
+        int fd;
+        RequestHandler* handler;
+    };
+
+    struct Connection {
+        int fd;
+        RequestHandler* handler;
+        ReceiveBuffer input;  // Incomplete request carried over to the next message
+        std::string output;   // Responses handled while a send is in flight
+        std::string sending;  // Responses of the send in flight
+        size_t sent = 0;      // Bytes of sending already sent
+        bool recvArmed = false;
+        bool starved = false; // Recv ended for lack of buffers: waits in `starved`
+        bool sendInFlight = false;
+        bool readPaused = false;
+        bool closeWhenFlushed = false; // The client is done or the stream is corrupt
+        bool closing = false;          // Error: cancel everything and close
+
+        Connection(int socket, RequestHandler* requestHandler)
+            : fd(socket), handler(requestHandler), input(INPUT_CAPACITY, requestHandler->maxRequestSize()) {
+            output.reserve(OUTPUT_CAPACITY);
+            sending.reserve(OUTPUT_CAPACITY);
+        }
+    };
+
+    int ringFd = -1;
+    int wakeFd = -1;
+
+    // Submission queue
+    void* sqRing = MAP_FAILED;
+    size_t sqRingSize = 0;
+    unsigned* sqHead;
+    unsigned* sqTail;
+    unsigned sqMask;
+    unsigned sqEntries;
+    unsigned* sqArray;
+    io_uring_sqe* sqes = (io_uring_sqe*)MAP_FAILED;
+    size_t sqesSize = 0;
+    unsigned sqLocalTail = 0; // SQEs prepared, published to the kernel on submit
+    unsigned sqSubmitted = 0;
+
+    // Completion queue
+    void* cqRing = MAP_FAILED;
+    size_t cqRingSize = 0;
+    unsigned* cqHead;
+    unsigned* cqTail;
+    unsigned cqMask;
+    io_uring_cqe* cqes;
+    std::vector<io_uring_cqe> reaped; // Taken off the CQ by getSqe(), handled first
+    size_t reapedNext = 0;
+
+    // Provided buffer ring for multishot recv
+    io_uring_buf_ring* bufferRing = (io_uring_buf_ring*)MAP_FAILED;
+    size_t bufferRingSize = 0;
+    std::unique_ptr<char[]> bufferMemory;
+    uint16_t bufferTail = 0;
+    std::deque<int> starved; // Connections to re-arm once buffers are back, oldest first
+
+    std::vector<Listener> listeners;
+    std::vector<std::unique_ptr<Connection>> connections; // Indexed by file descriptor
+    size_t openConnections = 0;
+    size_t syscalls = 0;
+    std::atomic<bool> stopping{false};
+
+    static void fail(const char* what) {
+        throw std::runtime_error(std::string(what) + ": " + strerror(errno));
+    }
+
+    static uint64_t userData(Operation operation, uint32_t index) { return operation << 32 | index; }
+
+    // Next free SQE, cleared. Submits early when the queue is full. The kernel refuses
+    // new submissions while completions it could not post are waiting (EBUSY), so then
+    // the CQ is emptied into `reaped` and the submit retried until a slot is free.
+    io_uring_sqe* getSqe() {
+        while (sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE) >= sqEntries) {
+            unsigned before = sqSubmitted;
+            submit(0);
+            if (sqSubmitted == before)
+                reapCompletions();
+        }
+        io_uring_sqe* sqe = &sqes[sqLocalTail & sqMask];
+        memset(sqe, 0, sizeof(*sqe));
+        sqArray[sqLocalTail & sqMask] = sqLocalTail & sqMask;
+        sqLocalTail++;
+        return sqe;
+    }
+
+    // Hand the prepared SQEs to the kernel and wait for at least waitFor completions.
+    // The buffers returned so far are published first, so a recv submitted here can
+    // use them.
+    void submit(unsigned waitFor) {
+        __atomic_store_n(&bufferRing->tail, bufferTail, __ATOMIC_RELEASE);
+        __atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+        unsigned toSubmit = sqLocalTail - sqSubmitted;
+        syscalls++;
+        int submitted = (int)syscall(__NR_io_uring_enter, ringFd, toSubmit, waitFor,
+            waitFor > 0 ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+        if (submitted < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+                return; // Retried with the next submit
+            fail("io_uring_enter");
+        }
+        sqSubmitted += submitted;
+    }
+
+    void armAccept(uint32_t listener) {
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->fd = listeners[listener].fd;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+        sqe->accept_flags = SOCK_CLOEXEC;
+        sqe->user_data = userData(ACCEPT, listener);
+    }
+
+    void armRecv(Connection& connection) {
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_RECV;
+        sqe->fd = connection.fd;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = BUFFER_GROUP;
+        sqe->user_data = userData(RECV, connection.fd);
+        connection.recvArmed = true;
+        connection.starved = false;
+    }
+
+    // Re-arm the connections whose recv ran out of buffers. Every buffer is back in
+    // the ring once a batch of completions has been handled, so up to BUFFER_COUNT of
+    // them get one; the others wait for the next batch. Re-arming them as soon as the
+    // recv failed would only fail again, as nothing is returned in the middle of a batch.
+    void resumeStarved() {
+        for (unsigned budget = BUFFER_COUNT; budget > 0 && !starved.empty(); starved.pop_front()) {
+            int fd = starved.front();
+            Connection* connection = (size_t)fd < connections.size() ? connections[fd].get() : nullptr;
+            if (!connection || !connection->starved)
+                continue; // Closed, or re-armed already
+            connection->starved = false;
+            if (connection->recvArmed || connection->closing || connection->closeWhenFlushed ||
+                connection->readPaused)
+                continue;
+            armRecv(*connection);
+            budget--;
+        }
+    }
+
+    void armWake() {
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = wakeFd;
+        sqe->poll32_events = POLLIN;
+        sqe->len = IORING_POLL_ADD_MULTI;
+        sqe->user_data = userData(WAKE, 0);
+    }
+
+    // Cancel the connection's recv, or every operation on it
+    void cancel(Connection& connection, bool all) {
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        if (all) {
+            sqe->fd = connection.fd;
+            sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        } else {
+            sqe->addr = userData(RECV, connection.fd);
+        }
+        sqe->user_data = userData(CANCEL, connection.fd);
+    }
+
+    // Send the responses queued in output, unless a send is in flight already
+    void flush(Connection& connection) {
+        if (connection.sendInFlight || connection.closing || connection.output.empty())
+            return;
+        connection.sending.swap(connection.output);
+        connection.sent = 0;
+        submitSend(connection);
+    }
+
+    void submitSend(Connection& connection) {
+        io_uring_sqe* sqe = getSqe();
+        sqe->opcode = IORING_OP_SEND;
+        sqe->fd = connection.fd;
+        sqe->addr = (uint64_t)(connection.sending.data() + connection.sent);
+        sqe->len = (uint32_t)(connection.sending.size() - connection.sent);
+        sqe->msg_flags = MSG_NOSIGNAL;
+        sqe->user_data = userData(SEND, connection.fd);
+        connection.sendInFlight = true;
+    }
+
+    void beginClose(Connection& connection) {
+        if (connection.closing)
+            return;
+        connection.closing = true;
+        if (connection.recvArmed || connection.sendInFlight)
+            cancel(connection, true);
+    }
+
+    // Free the connection once it is closing and nothing in flight uses it. Callers
+    // must not touch the connection afterwards.
+    void finishIfDone(Connection& connection) {
+        bool flushed = connection.output.empty() && !connection.sendInFlight;
+        if (!(connection.closing || (connection.closeWhenFlushed && flushed)))
+            return;
+        if (connection.recvArmed || connection.sendInFlight)
+            return;
+        int fd = connection.fd;
+        syscalls++;
+        ::close(fd);
+        connections[fd].reset();
+        openConnections--;
+    }
+
+    // Return a buffer to the ring; published to the kernel after the batch
+    void recycleBuffer(uint16_t bufferId) {
+        // Not bufferRing->bufs: in C++ the kernel header's flexible array member starts
+        // 8 bytes late (its empty placeholder struct has size 1)
+        io_uring_buf* buffer = (io_uring_buf*)bufferRing + (bufferTail & (BUFFER_COUNT - 1));
+        buffer->addr = (uint64_t)(bufferMemory.get() + (size_t)bufferId * BUFFER_SIZE);
+        buffer->len = BUFFER_SIZE;
+        buffer->bid = bufferId;
+        bufferTail++;
+    }
+
+    // Hand received bytes to the handler. Returns false when the connection must close.
+    bool handleData(Connection& connection, const char* data, size_t size) {
+        const char* pending = data;
+        size_t pendingSize = size;
+        if (connection.input.readable() > 0) {
+            // Completes a request from an earlier message: append, then parse from input
+            while (size > 0) {
+                size_t space = connection.input.prepareWrite();
+                if (space == 0)
+                    return false; // A single request larger than the handler accepts
+                size_t chunk = size < space ? size : space;
+                memcpy(connection.input.writePointer(), data, chunk);
+                connection.input.commit(chunk);
+                data += chunk;
+                size -= chunk;
+                size_t consumed = connection.handler->onData(connection.input.readPointer(),
+                    connection.input.readable(), connection.output);
+                if (consumed == RequestHandler::CLOSE_CONNECTION)
+                    return false;
+                connection.input.consume(consumed);
+            }
+            return true;
+        }
+
+        // Nothing carried over: parse in place, keep only the incomplete tail
+        size_t consumed = connection.handler->onData(pending, pendingSize, connection.output);
+        if (consumed == RequestHandler::CLOSE_CONNECTION)
+            return false;
+        pending += consumed;
+        pendingSize -= consumed;
+        while (pendingSize > 0) {
+            size_t space = connection.input.prepareWrite();
+            if (space == 0)
+                return false;
+            size_t chunk = pendingSize < space ? pendingSize : space;
+            memcpy(connection.input.writePointer(), pending, chunk);
+            connection.input.commit(chunk);
+            pending += chunk;
+            pendingSize -= chunk;
+        }
+        return true;
+    }
+
+    void onAccept(uint32_t listener, const io_uring_cqe& cqe) {
+        if (!(cqe.flags & IORING_CQE_F_MORE) && !stopping.load(std::memory_order_relaxed))
+            armAccept(listener);
+        if (cqe.res < 0) {
+            if (cqe.res == -EMFILE || cqe.res == -ENFILE)
+                std::cerr << "Accepting connection failed: too many open files" << std::endl;
+            return;
+        }
+
+        // Responses are small and should not wait for Nagle's algorithm
+        int fd = cqe.res;
+        int one = 1;
+        syscalls++;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if ((size_t)fd >= connections.size())
+            connections.resize(fd + 1);
+        connections[fd].reset(new Connection(fd, listeners[listener].handler));
+        openConnections++;
+        armRecv(*connections[fd]);
+    }
+
+    void onRecv(Connection& connection, const io_uring_cqe& cqe) {
+        bool more = cqe.flags & IORING_CQE_F_MORE;
+        if (!more)
+            connection.recvArmed = false;
+
+        if (cqe.res > 0) {
+            uint16_t bufferId = (uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            bool ok = connection.closing || connection.closeWhenFlushed ||
+                handleData(connection, bufferMemory.get() + (size_t)bufferId * BUFFER_SIZE, cqe.res);
+            recycleBuffer(bufferId);
+            if (!ok) {
+                // Corrupt stream: send the error the handler wrote, then close
+                connection.closeWhenFlushed = true;
+                if (connection.recvArmed)
+                    cancel(connection, false);
+            }
+            flush(connection);
+            if (!connection.closeWhenFlushed && !connection.readPaused &&
+                connection.output.size() + connection.sending.size() > MAX_PENDING_OUTPUT) {
+                // The client does not read its responses: stop reading its requests
+                connection.readPaused = true;
+                if (connection.recvArmed)
+                    cancel(connection, false);
+            }
+        } else if (cqe.res == 0) {
+            // The client is done: send what is left, then close
+            connection.closeWhenFlushed = true;
+        } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {
+            beginClose(connection);
+        }
+
+        // Multishot recv ends when the buffer ring runs dry (ENOBUFS), after a cancel and
+        // whenever the kernel chooses to. Whatever ended it, a connection that should be
+        // reading reads again: a cancel for a pause may complete after onSend() lifted it.
+        if (!connection.recvArmed && !connection.closing && !connection.closeWhenFlushed && !connection.readPaused) {
+            if (cqe.res == -ENOBUFS) {
+                connection.starved = true;
+                starved.push_back(connection.fd);
+            } else {
+                armRecv(connection);
+            }
+        }
+        finishIfDone(connection);
+    }
+
+    void onSend(Connection& connection, const io_uring_cqe& cqe) {
+        connection.sendInFlight = false;
+        if (cqe.res < 0) {
+            beginClose(connection);
+            finishIfDone(connection);
+            return;
+        }
+        connection.sent += cqe.res;
+        if (connection.sent < connection.sending.size() && !connection.closing) {
+            submitSend(connection);
+            return;
+        }
+        connection.sending.clear();
+        flush(connection);
+        if (connection.readPaused && !connection.sendInFlight && !connection.closing &&
+            !connection.closeWhenFlushed) {
+            // Everything queued was sent: take the input the kernel kept for us
+            connection.readPaused = false;
+            if (!connection.recvArmed)
+                armRecv(connection);
+        }
+        finishIfDone(connection);
+    }
+
+    // Move every posted completion off the CQ without handling it
+    void reapCompletions() {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+            reaped.push_back(cqes[head & cqMask]);
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    // Next completion in the order the kernel posted it, up to the CQ tail `end`: the
+    // reaped ones come first. Each is taken off the CQ before it is handled, as handling
+    // may reap the rest.
+    bool nextCompletion(io_uring_cqe& cqe, unsigned end) {
+        if (reapedNext < reaped.size()) {
+            cqe = reaped[reapedNext++];
+            if (reapedNext == reaped.size()) {
+                reaped.clear();
+                reapedNext = 0;
+            }
+            return true;
+        }
+        unsigned head = *cqHead;
+        if ((int)(end - head) <= 0)
+            return false;
+        cqe = cqes[head & cqMask];
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // Handle the completions posted so far. Those posted meanwhile, by the submits of a
+    // full SQ, wait for the next batch, so that a batch always ends.
+    void processCompletions() {
+        unsigned end = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        io_uring_cqe cqe;
+        while (nextCompletion(cqe, end)) {
+            Operation operation = (Operation)(cqe.user_data >> 32);
+            uint32_t index = (uint32_t)cqe.user_data;
+            if (operation == ACCEPT) {
+                onAccept(index, cqe);
+                continue;
+            }
+            if (operation == WAKE || operation == CANCEL)
+                continue;
+
+            Connection* connection = index < connections.size() ? connections[index].get() : nullptr;
+            if (!connection) {
+                // Data for a connection freed earlier in this batch: give the buffer back
+                if (operation == RECV && cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER))
+                    recycleBuffer((uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+                continue;
+            }
+            if (operation == RECV)
+                onRecv(*connection, cqe);
+            else if (operation == SEND)
+                onSend(*connection, cqe);
+        }
+    }
+
+    void setupRing() {
+        io_uring_params params{};
+        params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+        params.cq_entries = RING_ENTRIES * 4;
+        if ((ringFd = (int)syscall(__NR_io_uring_setup, RING_ENTRIES, &params)) < 0)
+            fail("io_uring_setup");
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+            errno = ENOSYS;
+            fail("io_uring_setup (kernel too old)");
+        }
+
+        // Both rings share one mapping; the SQEs have their own
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        sqRingSize = sqRingSize > cqRingSize ? sqRingSize : cqRingSize;
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+            IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED)
+            fail("mmap");
+        cqRing = sqRing;
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqes = (io_uring_sqe*)mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd,
+            IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            fail("mmap");
+
+        char* sq = (char*)sqRing;
+        sqHead = (unsigned*)(sq + params.sq_off.head);
+        sqTail = (unsigned*)(sq + params.sq_off.tail);
+        sqMask = *(unsigned*)(sq + params.sq_off.ring_mask);
+        sqEntries = *(unsigned*)(sq + params.sq_off.ring_entries);
+        sqArray = (unsigned*)(sq + params.sq_off.array);
+        sqLocalTail = sqSubmitted = *sqTail;
+        char* cq = (char*)cqRing;
+        cqHead = (unsigned*)(cq + params.cq_off.head);
+        cqTail = (unsigned*)(cq + params.cq_off.tail);
+        cqMask = *(unsigned*)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+        // Register the receive buffers: the ring of buffer descriptors is shared memory
+        bufferRingSize = BUFFER_COUNT * sizeof(io_uring_buf);
+        bufferRing = (io_uring_buf_ring*)mmap(nullptr, bufferRingSize, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (bufferRing == MAP_FAILED)
+            fail("mmap");
+        io_uring_buf_reg registration{};
+        registration.ring_addr = (uint64_t)bufferRing;
+        registration.ring_entries = BUFFER_COUNT;
+        registration.bgid = BUFFER_GROUP;
+        if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PBUF_RING, &registration, 1) < 0)
+            fail("IORING_REGISTER_PBUF_RING");
+        bufferMemory.reset(new char[(size_t)BUFFER_COUNT * BUFFER_SIZE]);
+        for (unsigned i = 0; i < BUFFER_COUNT; i++)
+            recycleBuffer((uint16_t)i);
+        __atomic_store_n(&bufferRing->tail, bufferTail, __ATOMIC_RELEASE);
+    }
+
+    void release() {
+        // Closing the ring cancels its operations before the connections go away
+        if (ringFd >= 0)
+            ::close(ringFd);
+        ringFd = -1;
+        for (std::unique_ptr<Connection>& connection : connections)
+            if (connection)
+                ::close(connection->fd);
+        connections.clear();
+        for (Listener& listener : listeners)
+            ::close(listener.fd);
+        listeners.clear();
+        if (bufferRing != MAP_FAILED)
+            munmap(bufferRing, bufferRingSize);
+        if (sqes != MAP_FAILED)
+            munmap(sqes, sqesSize);
+        if (sqRing != MAP_FAILED)
+            munmap(sqRing, sqRingSize);
+        bufferRing = (io_uring_buf_ring*)MAP_FAILED;
+        sqes = (io_uring_sqe*)MAP_FAILED;
+        sqRing = cqRing = MAP_FAILED;
+        if (wakeFd >= 0)
+            ::close(wakeFd);
+        wakeFd = -1;
+    }
+
+public:
+    UringLoop() {
+        if ((wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+            fail("eventfd");
+        try {
+            setupRing();
+        } catch (...) {
+            release();
+            throw;
+        }
+    }
+
+    ~UringLoop() {
+        release();
+    }
+
+    UringLoop(const UringLoop&) = delete;
+    UringLoop& operator=(const UringLoop&) = delete;
+
+    // Accept connections on the port and serve them with the handler. Listens right
+    // away, so a bind error is reported to the caller.
+    void listen(int port, RequestHandler& handler, int backlog = SOMAXCONN) {
+        // Creating socket file descriptor
+        int listenFd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listenFd < 0)
+            fail("Socket creation error");
+        listeners.push_back(Listener{listenFd, &handler});
+
+        // Every loop listens on the same port; the kernel balances connections
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (setsockopt(listenFd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0)
+            fail("SO_REUSEPORT");
+
+        // Assigning address and port
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = INADDR_ANY;
+        address.sin_port = htons(port);
+        if (bind(listenFd, (sockaddr*)&address, sizeof(address)) < 0)
+            fail("Binding error");
+        if (::listen(listenFd, backlog) < 0)
+            fail("Listening error");
+    }
+
+    size_t getOpenConnections() const { return openConnections; }
+
+    // System calls made by run(): io_uring_enter, and setsockopt / close per connection
+    size_t getSyscalls() const { return syscalls; }
+
+    // Serve until stop() is called
+    void run() {
+        for (uint32_t i = 0; i < listeners.size(); i++)
+            armAccept(i);
+        armWake();
+        while (!stopping.load(std::memory_order_acquire)) {
+            // Submit everything prepared while handling the last batch, wait for the next
+            submit(1);
+            processCompletions();
+            resumeStarved();
+        }
+    }
+
+    // Thread-safe: makes run() return after the completions it is handling
+    void stop() {
+        stopping.store(true, std::memory_order_release);
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+};
+
+#endif
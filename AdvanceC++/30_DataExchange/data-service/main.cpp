@@ -1,80 +1,81 @@
 #include <iostream>
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <unistd.h>
-#include <cstring>
-#include <sstream>
+#include <thread>
 #include <vector>
+#include <memory>
+#include <atomic>
+#include <string>
+#include <csignal>
+#include <cstdlib>
+#include "EventLoop.h"
+#include "UringLoop.h"
 
 #define PORT 8080
+#define BINARY_PORT 8081
 
-int main() {
-    int server_fd, new_socket;
-    struct sockaddr_in address;
-    int addrlen = sizeof(address);
-    char buffer[1024] = {0};
+// Event loops to stop on SIGINT / SIGTERM (docker stop), one list per backend
+template <typename Loop>
+std::vector<std::unique_ptr<Loop>> eventLoops;
 
-    // Creating socket file descriptor
-    if ((server_fd = socket(AF_INET, SOCK_STREAM, 0)) == 0) {
-        std::cerr << "Socket creation error!" << std::endl;
-        return -1;
-    }
-
-    // Assigning address and port
-    address.sin_family = AF_INET;
-    address.sin_addr.s_addr = INADDR_ANY;
-    address.sin_port = htons(PORT);
+template <typename Loop>
+void stopAll(int) {
+    for (std::unique_ptr<Loop>& loop : eventLoops<Loop>)
+        loop->stop();
+}
 
-    // Bind the socket to the network address and port
-    if (bind(server_fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
-        std::cerr << "Binding error!" << std::endl;
+// Run `loops` loops of the backend until a signal stops them
+template <typename Loop>
+int serve(const char* backend, int port, int binaryPort, unsigned loops) {
+    // Every loop listens on the port itself (SO_REUSEPORT)
+    std::atomic<size_t> requests{0};
+    SumHandler textHandler(requests);
+    BinarySumHandler binaryHandler(requests);
+    try {
+        for (unsigned i = 0; i < loops; i++) {
+            eventLoops<Loop>.emplace_back(new Loop());
+            eventLoops<Loop>.back()->listen(port, textHandler);
+            eventLoops<Loop>.back()->listen(binaryPort, binaryHandler);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        eventLoops<Loop>.clear();
         return -1;
     }
 
-    // Listen for incoming connections
-    if (listen(server_fd, 3) < 0) {
-        std::cerr << "Listening error!" << std::endl;
-        return -1;
-    }
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, stopAll<Loop>);
+    signal(SIGTERM, stopAll<Loop>);
+    std::cout << "Server listening on port: " << port << " (text), " << binaryPort << " (binary), "
+              << loops << " " << backend << " event loops" << std::endl;
 
-    std::cout << "Server listening on port: " << PORT << std::endl;
+    // One thread per loop; the main thread runs the first one
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < loops; i++)
+        threads.emplace_back([i]() { eventLoops<Loop>[i]->run(); });
+    eventLoops<Loop>[0]->run();
+    for (std::thread& thread : threads)
+        thread.join();
 
-    // Accept the connection
-    if ((new_socket = accept(server_fd, (struct sockaddr*)&address, (socklen_t*)&addrlen)) < 0) {
-        std::cerr << "Accepting connection failed!" << std::endl;
-        return -1;
-    }
-    
-    std::cout << "Client connected!" << std::endl;
+    size_t syscalls = 0;
+    for (std::unique_ptr<Loop>& loop : eventLoops<Loop>)
+        syscalls += loop->getSyscalls();
+    std::cout << "Server stopped after " << requests.load() << " requests, " << syscalls << " syscalls ("
+              << (double)syscalls / std::max<size_t>(1, requests.load()) << " per request)" << std::endl;
+    eventLoops<Loop>.clear();
+    return 0;
+}
 
-    // Handle multiple requests from the same client
-    while (true) {
-        memset(buffer, 0, sizeof(buffer));
-        int bytes_read = read(new_socket, buffer, 1024);
-        
-        if (bytes_read <= 0) {
-            std::cout << "Client disconnected or read error" << std::endl;
-            break;
-        }
-        
-        std::cout << "Server received numbers: " << buffer << std::endl;
-        
-        // Parse numbers and calculate sum
-        std::stringstream ss(buffer);
-        std::string number;
-        int sum = 0;
-        
-        while (std::getline(ss, number, ',')) {
-            sum += std::stoi(number);
-        }
-        
-        // Send sum back to client
-        std::string response = std::to_string(sum);
-        send(new_socket, response.c_str(), response.length(), 0);
-        std::cout << "Sum sent to client: " << sum << std::endl;
-    }
+// Usage: data-service [port] [event loops] [binary port] [epoll|uring]
+// Defaults to the text protocol on port 8080, the binary protocol on port 8081 and
+// one epoll event loop per core.
+int main(int argc, char* argv[]) {
+    int port = argc > 1 ? atoi(argv[1]) : PORT;
+    unsigned loops = argc > 2 ? (unsigned)atoi(argv[2]) : std::thread::hardware_concurrency();
+    int binaryPort = argc > 3 ? atoi(argv[3]) : BINARY_PORT;
+    std::string backend = argc > 4 ? argv[4] : "epoll";
+    if (loops == 0)
+        loops = 1;
 
-    close(new_socket);
-    close(server_fd);
-    return 0;
+    if (backend == "uring")
+        return serve<UringLoop>("io_uring", port, binaryPort, loops);
+    return serve<EventLoop>("epoll", port, binaryPort, loops);
 }
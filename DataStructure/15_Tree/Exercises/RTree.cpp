@@ -3,7 +3,17 @@
 #include <algorithm>
 #include <limits>
 #include <cmath>
-#include <queue>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <cstdint>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
 /*
 * RTree Implementation:
@@ -20,20 +30,49 @@
         - area(): Calculates the area of the box.
         - combine(BoundingBox, BoundingBox): Creates a new box that encompasses both input boxes.
         - intersect: returns the intersection of two bounding boxes
-## 3. Node Structure:
+
+## 3. BoxArray Structure:
+    * Structure-of-arrays storage for the bounding boxes of one node: minX[], minY[], maxX[], maxY[].
+    * Keeping each coordinate contiguous lets overlapping() test 4 boxes (double) or 8 boxes (float)
+      per AVX2 instruction instead of one BoundingBox at a time. Without __AVX2__ (compile with
+      -mavx2 or -march=native to enable it) the same loop runs as plain scalar code.
+    * Coord is double by default. Compiling with -DRTREE_FLOAT32 stores float coordinates instead,
+      halving the node size. Boxes are rounded outward when converted to float, so the filter is
+      conservative and leaf hits are re-checked against the exact double-precision points.
+    * Includes methods for:
+        - push_back(BoundingBox) / set(i, BoundingBox) / operator[](i): Write and read a box.
+        - erase(i): Removes the box at index i, keeping the order of the others.
+        - overlapping(BoundingBox, std::vector<int>&): Collects the indexes of all boxes overlapping a query box.
+
+## 4. Node Structure:
     * Represents a node in the R-tree.
         - isLeaf: Boolean indicating whether the node is a leaf node.
-        - boxes: Vector of bounding boxes for the children (internal nodes) or points (leaf nodes).
+        - boxes: BoxArray of bounding boxes for the children (internal nodes) or one degenerate box per point (leaf nodes).
         - children: Vector of child node pointers (only for internal nodes).
         - points: Vector of points (only for leaf nodes).
         - The destructor ~Node() recursively deletes all child nodes to prevent memory leaks.
-## 4. RTree Class:
+## 5. WorkStealingPool Class:
+    * A fixed set of worker threads that live as long as the pool.
+    * Each worker owns a deque of task indexes. It pops from the back of its own deque and,
+      once that is empty, steals from the front of the other workers' deques, so a worker that
+      drew cheap queries keeps helping the ones that drew expensive queries.
+        - run(numTasks, task): Calls task(i, worker) for every i in [0, numTasks) and waits for all of them.
+          Thread-safe: concurrent calls run one after the other.
+
+## 6. BatchResult Structure:
+    * The results of a batch of queries in one contiguous buffer.
+        - points: All matching points, grouped by query.
+        - offsets: The results of query i are points[offsets[i], offsets[i + 1]).
+        - begin(i) / end(i) / count(i): The span of results that belongs to query i.
+
+## 7. RTree Class:
     * root: Pointer to the root node of the R-tree.
     * maxChildren: Maximum number of children allowed per node (determines the tree's branching factor).
     * minChildren: Minimum number of children allowed per node
     * Helper Functions:
         - calculateBoundingBox(const std::vector<Point>&): Calculates the MBR for a set of points.
         - calculateBoundingBox(const std::vector<BoundingBox>&): Calculates the MBR for a set of bounding boxes.
+        - calculateBoundingBox(const BoxArray&): Calculates the MBR for the boxes of a node.
         - chooseSubtree(Node*, const Point&): Selects the best subtree to insert a point.
         - chooseSubtree(Node*, const BoundingBox&): Selects the best subtree to insert a bounding box.
         - adjustTree(Node*): Adjusts the bounding boxes of parent nodes after insertion.
@@ -44,17 +83,33 @@
         - splitNode(Node*, const BoundingBox&, Node*&): Splits a node that has overflowed after insertion of a bounding box.
         - getPointsAtIndexes: Returns a vector of points at the given indexes.
         - getBoxesAtIndexes: Returns a vector of bounding boxes at the given indexes.
+        - searchInto(const BoundingBox&, std::vector<Point>&, SearchScratch&): Depth-first search that appends to an
+          output vector and reuses the caller's scratch buffers, so it is safe to run concurrently on a read-only tree.
+        - hilbertIndex(uint32_t, uint32_t, uint32_t): Position of a grid cell along a Hilbert curve.
+        - findLeaf(Node*, const Point&, std::vector<Node*>&, int&): Finds the leaf holding a point, recording the path from the root.
+        - collectPoints(Node*, std::vector<Point>&): Gathers every point stored under a node.
+        - condenseTree(std::vector<Node*>&): After a removal, walks back up the path, dissolves nodes that fell below
+          minChildren (their points are reinserted) and shrinks the bounding boxes of the remaining ancestors.
     * Public Methods:
         - RTree(int): Constructor that initializes the R-tree with a maximum number of children.
         - ~RTree(): Destructor that deletes the entire tree to free memory.
         - insert(const Point&): Inserts a point into the R-tree.
+        - remove(const Point&): Removes one occurrence of a point and condenses the tree. Returns false if the point is not stored.
+        - update(const Point&, const Point&): Moves a point. When the new position is still inside the leaf's bounding box the
+          point is replaced in place and nothing above the leaf is touched; otherwise it falls back to remove + insert.
         - search(const BoundingBox&): Searches for points within a given bounding box.
+        - searchBatch(const std::vector<BoundingBox>&): Runs many independent searches in parallel. The queries are
+          sorted along a Hilbert curve of their centers so neighbouring queries run back to back on the same worker,
+          then split into chunks that are executed on a WorkStealingPool. The tree must not be modified meanwhile;
+          concurrent batches on the same tree are safe and share the pool one batch at a time.
         - printTree(): Prints the structure of the R-tree (for debugging).
-## 5. Main Function:
+## 8. Main Function:
     * Creates an R-tree.
     * Inserts sample points.
     * Performs a search.
     * Prints the search results.
+    * Performs a batch of searches and prints the number of results per query.
+    * Moves and removes points and prints the resulting tree.
 
  * */
 // Define a point in 2D space
@@ -114,10 +169,119 @@ struct BoundingBox {
     }
 };
 
+#ifdef RTREE_FLOAT32
+typedef float Coord;
+#else
+typedef double Coord;
+#endif
+
+// Round a coordinate down/up to the nearest Coord so a converted box never shrinks
+inline Coord roundDown(double v) {
+    Coord c = static_cast<Coord>(v);
+    return c > v ? std::nextafter(c, -std::numeric_limits<Coord>::infinity()) : c;
+}
+
+inline Coord roundUp(double v) {
+    Coord c = static_cast<Coord>(v);
+    return c < v ? std::nextafter(c, std::numeric_limits<Coord>::infinity()) : c;
+}
+
+// Bounding boxes of one node stored as a structure of arrays
+struct BoxArray {
+    std::vector<Coord> minX, minY, maxX, maxY;
+
+    size_t size() const { return minX.size(); }
+    bool empty() const { return minX.empty(); }
+
+    void clear() {
+        minX.clear();
+        minY.clear();
+        maxX.clear();
+        maxY.clear();
+    }
+
+    void push_back(const BoundingBox& box) {
+        minX.push_back(roundDown(box.minX));
+        minY.push_back(roundDown(box.minY));
+        maxX.push_back(roundUp(box.maxX));
+        maxY.push_back(roundUp(box.maxY));
+    }
+
+    void erase(size_t i) {
+        minX.erase(minX.begin() + i);
+        minY.erase(minY.begin() + i);
+        maxX.erase(maxX.begin() + i);
+        maxY.erase(maxY.begin() + i);
+    }
+
+    void set(size_t i, const BoundingBox& box) {
+        minX[i] = roundDown(box.minX);
+        minY[i] = roundDown(box.minY);
+        maxX[i] = roundUp(box.maxX);
+        maxY[i] = roundUp(box.maxY);
+    }
+
+    BoundingBox operator[](size_t i) const {
+        return {minX[i], minY[i], maxX[i], maxY[i]};
+    }
+
+    std::vector<BoundingBox> toVector() const {
+        std::vector<BoundingBox> result;
+        result.reserve(size());
+        for (size_t i = 0; i < size(); ++i) {
+            result.push_back((*this)[i]);
+        }
+        return result;
+    }
+
+    // Append the indexes of all boxes that overlap the query box to out
+    void overlapping(const BoundingBox& query, std::vector<int>& out) const {
+        const Coord qMinX = roundDown(query.minX), qMinY = roundDown(query.minY);
+        const Coord qMaxX = roundUp(query.maxX), qMaxY = roundUp(query.maxY);
+        const size_t n = size();
+        size_t i = 0;
+#ifdef __AVX2__
+#ifdef RTREE_FLOAT32
+        const __m256 vMinX = _mm256_set1_ps(qMinX), vMinY = _mm256_set1_ps(qMinY);
+        const __m256 vMaxX = _mm256_set1_ps(qMaxX), vMaxY = _mm256_set1_ps(qMaxY);
+        for (; i + 8 <= n; i += 8) {
+            __m256 x = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&maxX[i]), vMinX, _CMP_GE_OQ),
+                                     _mm256_cmp_ps(_mm256_loadu_ps(&minX[i]), vMaxX, _CMP_LE_OQ));
+            __m256 y = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(&maxY[i]), vMinY, _CMP_GE_OQ),
+                                     _mm256_cmp_ps(_mm256_loadu_ps(&minY[i]), vMaxY, _CMP_LE_OQ));
+            int mask = _mm256_movemask_ps(_mm256_and_ps(x, y));
+            for (int b = 0; b < 8; ++b) {
+                if (mask & (1 << b)) out.push_back(static_cast<int>(i) + b);
+            }
+        }
+#else
+        const __m256d vMinX = _mm256_set1_pd(qMinX), vMinY = _mm256_set1_pd(qMinY);
+        const __m256d vMaxX = _mm256_set1_pd(qMaxX), vMaxY = _mm256_set1_pd(qMaxY);
+        for (; i + 4 <= n; i += 4) {
+            __m256d x = _mm256_and_pd(_mm256_cmp_pd(_mm256_loadu_pd(&maxX[i]), vMinX, _CMP_GE_OQ),
+                                      _mm256_cmp_pd(_mm256_loadu_pd(&minX[i]), vMaxX, _CMP_LE_OQ));
+            __m256d y = _mm256_and_pd(_mm256_cmp_pd(_mm256_loadu_pd(&maxY[i]), vMinY, _CMP_GE_OQ),
+                                      _mm256_cmp_pd(_mm256_loadu_pd(&minY[i]), vMaxY, _CMP_LE_OQ));
+            int mask = _mm256_movemask_pd(_mm256_and_pd(x, y));
+            for (int b = 0; b < 4; ++b) {
+                if (mask & (1 << b)) out.push_back(static_cast<int>(i) + b);
+            }
+        }
+#endif
+#endif
+        // Scalar tail (or the whole node when AVX2 is not available)
+        for (; i < n; ++i) {
+            if (maxX[i] >= qMinX && minX[i] <= qMaxX && maxY[i] >= qMinY && minY[i] <= qMaxY) {
+                out.push_back(static_cast<int>(i));
+            }
+        }
+    }
+};
+
 // Node in the R-tree
 struct Node {
     bool isLeaf;
-    std::vector<BoundingBox> boxes;
+    BoxArray boxes;
     std::vector<Node*> children;
     std::vector<Point> points; // Only used in leaf nodes
 
@@ -130,11 +294,138 @@ struct Node {
     }
 };
 
+class WorkStealingPool {
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::mutex runMutex; // Held by run() for a whole batch: one batch at a time
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t, size_t)>* current = nullptr;
+    std::atomic<size_t> remaining{0};
+    size_t generation = 0;
+    bool stopping = false;
+
+    bool popTask(size_t worker, size_t& task) {
+        {
+            TaskQueue& own = *queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); ++k) {
+            TaskQueue& victim = *queues[(worker + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t worker) {
+        size_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            size_t task;
+            while (popTask(worker, task)) {
+                const std::function<void(size_t, size_t)>* fn;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    fn = current;
+                }
+                (*fn)(task, worker);
+                if (remaining.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done.notify_all();
+                }
+            }
+        }
+    }
+
+public:
+    explicit WorkStealingPool(size_t numThreads) {
+        if (numThreads == 0) numThreads = 1;
+        for (size_t i = 0; i < numThreads; ++i) {
+            queues.emplace_back(new TaskQueue());
+        }
+        for (size_t i = 0; i < numThreads; ++i) {
+            workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+
+    size_t size() const { return workers.size(); }
+
+    void run(size_t numTasks, const std::function<void(size_t, size_t)>& task) {
+        if (numTasks == 0) return;
+        std::lock_guard<std::mutex> runLock(runMutex);
+        std::unique_lock<std::mutex> lock(mutex);
+        current = &task;
+        remaining = numTasks;
+        // Hand each worker a contiguous block so neighbouring tasks stay on one thread until stolen
+        for (size_t w = 0; w < queues.size(); ++w) {
+            std::lock_guard<std::mutex> queueLock(queues[w]->mutex);
+            for (size_t i = w * numTasks / queues.size(); i < (w + 1) * numTasks / queues.size(); ++i) {
+                queues[w]->tasks.push_back(i);
+            }
+        }
+        ++generation;
+        wake.notify_all();
+        done.wait(lock, [&] { return remaining == 0; });
+        current = nullptr;
+    }
+};
+
+// Results of RTree::searchBatch, stored contiguously
+struct BatchResult {
+    std::vector<Point> points;
+    std::vector<size_t> offsets; // offsets.size() == number of queries + 1
+
+    const Point* begin(size_t query) const { return points.data() + offsets[query]; }
+    const Point* end(size_t query) const { return points.data() + offsets[query + 1]; }
+    size_t count(size_t query) const { return offsets[query + 1] - offsets[query]; }
+};
+
 class RTree {
 private:
     Node* root;
     int maxChildren; // Maximum number of children per node
     int minChildren; // Minimum number of children per node
+    std::unique_ptr<WorkStealingPool> pool; // Created on the first searchBatch call
+    std::once_flag poolCreated;
+
+    // Per-thread buffers reused across searches
+    struct SearchScratch {
+        std::vector<int> hits;
+        std::vector<Node*> stack;
+    };
 
     // Helper functions
     BoundingBox calculateBoundingBox(const std::vector<Point>& points) {
@@ -175,6 +466,18 @@ private:
         return {minX, minY, maxX, maxY};
     }
 
+    BoundingBox calculateBoundingBox(const BoxArray& boxes) {
+        if (boxes.empty()) {
+            return {0, 0, 0, 0}; // Return an empty box
+        }
+        double minX = *std::min_element(boxes.minX.begin(), boxes.minX.end());
+        double minY = *std::min_element(boxes.minY.begin(), boxes.minY.end());
+        double maxX = *std::max_element(boxes.maxX.begin(), boxes.maxX.end());
+        double maxY = *std::max_element(boxes.maxY.begin(), boxes.maxY.end());
+
+        return {minX, minY, maxX, maxY};
+    }
+
     Node* chooseSubtree(Node* node, const Point& point) {
         if (node->isLeaf) {
             return node;
@@ -229,7 +532,7 @@ private:
 
         int index = findChildIndex(parent, node);
         if(index == -1) return;
-        parent->boxes[index] = node->isLeaf ? calculateBoundingBox(node->points) : calculateBoundingBox(node->boxes);
+        parent->boxes.set(index, node->isLeaf ? calculateBoundingBox(node->points) : calculateBoundingBox(node->boxes));
 
         adjustTree(parent);
     }
@@ -284,8 +587,6 @@ private:
         // 1. Create a new node.
         newNode = new Node(node->isLeaf);
         // 2. Create temporary arrays to hold the existing children/points and the new point.
-        std::vector<BoundingBox> tempBoxes = node->boxes;
-        std::vector<Node*> tempChildren = node->children;
         std::vector<Point> tempPoints = node->points;
 
         tempPoints.push_back(point);
@@ -325,22 +626,22 @@ private:
         node->points.clear();
         node->boxes.clear();
 
-        //Assign points to the two nodes
+        //Assign points to the two nodes, one degenerate box per point
         for(int index : group1Indexes){
             node->points.push_back(tempPoints[index]);
+            node->boxes.push_back({tempPoints[index].x, tempPoints[index].y, tempPoints[index].x, tempPoints[index].y});
         }
         for(int index : group2Indexes){
             newNode->points.push_back(tempPoints[index]);
+            newNode->boxes.push_back({tempPoints[index].x, tempPoints[index].y, tempPoints[index].x, tempPoints[index].y});
         }
-        node->boxes.push_back(calculateBoundingBox(node->points));
-        newNode->boxes.push_back(calculateBoundingBox(newNode->points));
 
     }
     //Overload splitNode for non-leaf nodes
     void splitNode(Node* node, const BoundingBox& box, Node*& newNode) {
         newNode = new Node(false);
 
-        std::vector<BoundingBox> tempBoxes = node->boxes;
+        std::vector<BoundingBox> tempBoxes = node->boxes.toVector();
         std::vector<Node*> tempChildren = node->children;
         tempBoxes.push_back(box);
 
@@ -391,6 +692,118 @@ private:
         }
         return result;
     }
+    void searchInto(const BoundingBox& queryBox, std::vector<Point>& results, SearchScratch& scratch) const {
+        scratch.stack.clear();
+        scratch.stack.push_back(root);
+
+        while (!scratch.stack.empty()) {
+            Node* node = scratch.stack.back();
+            scratch.stack.pop_back();
+
+            scratch.hits.clear();
+            node->boxes.overlapping(queryBox, scratch.hits);
+            for (int i : scratch.hits) {
+                if (node->isLeaf) {
+                    // Re-check in double precision; the float32 filter is only conservative
+                    if (queryBox.contains(node->points[i])) {
+                        results.push_back(node->points[i]);
+                    }
+                } else {
+                    scratch.stack.push_back(node->children[i]);
+                }
+            }
+        }
+    }
+
+    // Position of cell (x, y) along a Hilbert curve filling an n x n grid, n a power of two
+    static uint64_t hilbertIndex(uint32_t n, uint32_t x, uint32_t y) {
+        uint64_t d = 0;
+        for (uint32_t s = n / 2; s > 0; s /= 2) {
+            uint32_t rx = (x & s) > 0;
+            uint32_t ry = (y & s) > 0;
+            d += static_cast<uint64_t>(s) * s * ((3 * rx) ^ ry);
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = n - 1 - x;
+                    y = n - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    Node* findLeaf(Node* node, const Point& point, std::vector<Node*>& path, int& index) {
+        path.push_back(node);
+        if (node->isLeaf) {
+            for (size_t i = 0; i < node->points.size(); ++i) {
+                if (node->points[i].x == point.x && node->points[i].y == point.y) {
+                    index = static_cast<int>(i);
+                    return node;
+                }
+            }
+        } else {
+            for (size_t i = 0; i < node->children.size(); ++i) {
+                if (node->boxes[i].contains(point)) {
+                    Node* leaf = findLeaf(node->children[i], point, path, index);
+                    if (leaf != nullptr) {
+                        return leaf;
+                    }
+                }
+            }
+        }
+        path.pop_back();
+        return nullptr;
+    }
+
+    void collectPoints(Node* node, std::vector<Point>& out) {
+        if (node->isLeaf) {
+            out.insert(out.end(), node->points.begin(), node->points.end());
+            return;
+        }
+        for (Node* child : node->children) {
+            collectPoints(child, out);
+        }
+    }
+
+    // path runs from the root down to the leaf an entry was just removed from
+    void condenseTree(std::vector<Node*>& path) {
+        std::vector<Point> orphans;
+
+        for (size_t level = path.size() - 1; level > 0; --level) {
+            Node* node = path[level];
+            Node* parent = path[level - 1];
+            int index = findChildIndex(parent, node);
+            size_t entries = node->isLeaf ? node->points.size() : node->children.size();
+
+            if (entries < static_cast<size_t>(minChildren)) {
+                // Dissolve the underfull node and keep its points for reinsertion
+                collectPoints(node, orphans);
+                parent->boxes.erase(index);
+                parent->children.erase(parent->children.begin() + index);
+                delete node;
+            } else {
+                parent->boxes.set(index, node->isLeaf ? calculateBoundingBox(node->points) : calculateBoundingBox(node->boxes));
+            }
+        }
+
+        // Shorten the tree while the root is an internal node with a single child
+        while (!root->isLeaf && root->children.size() == 1) {
+            Node* oldRoot = root;
+            root = root->children[0];
+            oldRoot->children.clear();
+            delete oldRoot;
+        }
+        if (!root->isLeaf && root->children.empty()) {
+            delete root;
+            root = new Node(true);
+        }
+
+        for (const Point& point : orphans) {
+            insert(point);
+        }
+    }
+
     std::vector<BoundingBox> getBoxesAtIndexes(const std::vector<BoundingBox>& boxes, const std::vector<int>& indexes) {
         std::vector<BoundingBox> result;
         for (int index : indexes) {
@@ -413,7 +826,7 @@ public:
 
         if (leaf->points.size() < maxChildren) {
             leaf->points.push_back(point);
-            leaf->boxes = {calculateBoundingBox(leaf->points)};
+            leaf->boxes.push_back({point.x, point.y, point.x, point.y});
             adjustTree(leaf);
         } else {
             Node* newNode = nullptr;
@@ -430,35 +843,109 @@ public:
             } else {
                 parent->children.push_back(newNode);
                 parent->boxes.push_back(calculateBoundingBox(newNode->points));
-                adjustTree(parent);
+                adjustTree(leaf);
             }
         }
     }
 
+    bool remove(const Point& point) {
+        std::vector<Node*> path;
+        int index = -1;
+        Node* leaf = findLeaf(root, point, path, index);
+        if (leaf == nullptr) {
+            return false;
+        }
+
+        leaf->points.erase(leaf->points.begin() + index);
+        leaf->boxes.erase(index);
+        condenseTree(path);
+        return true;
+    }
+
+    bool update(const Point& oldPoint, const Point& newPoint) {
+        std::vector<Node*> path;
+        int index = -1;
+        Node* leaf = findLeaf(root, oldPoint, path, index);
+        if (leaf == nullptr) {
+            return false;
+        }
+
+        // Still inside the leaf's box in its parent: replace in place, no ancestor changes
+        if (leaf == root || path[path.size() - 2]->boxes[findChildIndex(path[path.size() - 2], leaf)].contains(newPoint)) {
+            leaf->points[index] = newPoint;
+            leaf->boxes.set(index, {newPoint.x, newPoint.y, newPoint.x, newPoint.y});
+            return true;
+        }
+
+        leaf->points.erase(leaf->points.begin() + index);
+        leaf->boxes.erase(index);
+        condenseTree(path);
+        insert(newPoint);
+        return true;
+    }
+
     std::vector<Point> search(const BoundingBox& queryBox) {
         std::vector<Point> results;
-        std::queue<Node*> q;
-        q.push(root);
-
-        while (!q.empty()) {
-            Node* node = q.front();
-            q.pop();
-
-            for (size_t i = 0; i < node->boxes.size(); ++i) {
-                if (queryBox.overlaps(node->boxes[i])) {
-                    if (node->isLeaf) {
-                        for (const auto& point : node->points) {
-                            if (queryBox.contains(point)) {
-                                results.push_back(point);
-                            }
-                        }
-                    } else {
-                        q.push(node->children[i]);
-                    }
-                }
+        SearchScratch scratch;
+        searchInto(queryBox, results, scratch);
+        return results;
+    }
+
+    BatchResult searchBatch(const std::vector<BoundingBox>& queries) {
+        const size_t numQueries = queries.size();
+        BatchResult result;
+        result.offsets.assign(numQueries + 1, 0);
+        if (numQueries == 0) {
+            return result;
+        }
+        std::call_once(poolCreated, [this] {
+            pool.reset(new WorkStealingPool(std::max(1u, std::thread::hardware_concurrency())));
+        });
+
+        // Sort the queries along a Hilbert curve of their centers (65536 x 65536 grid over the tree's MBR)
+        const uint32_t gridSize = 1u << 16;
+        BoundingBox world = calculateBoundingBox(root->boxes);
+        double width = std::max(world.maxX - world.minX, std::numeric_limits<double>::min());
+        double height = std::max(world.maxY - world.minY, std::numeric_limits<double>::min());
+        std::vector<std::pair<uint64_t, size_t>> order(numQueries);
+        for (size_t q = 0; q < numQueries; ++q) {
+            double cx = ((queries[q].minX + queries[q].maxX) / 2 - world.minX) / width;
+            double cy = ((queries[q].minY + queries[q].maxY) / 2 - world.minY) / height;
+            uint32_t gx = static_cast<uint32_t>(std::min(std::max(cx, 0.0), 1.0) * (gridSize - 1));
+            uint32_t gy = static_cast<uint32_t>(std::min(std::max(cy, 0.0), 1.0) * (gridSize - 1));
+            order[q] = {hilbertIndex(gridSize, gx, gy), q};
+        }
+        std::sort(order.begin(), order.end());
+
+        // Each chunk of consecutive (Hilbert-ordered) queries is one task with its own output buffer
+        const size_t chunkSize = 64;
+        const size_t numChunks = (numQueries + chunkSize - 1) / chunkSize;
+        std::vector<std::vector<Point>> chunkResults(numChunks);
+        std::vector<SearchScratch> scratch(pool->size());
+        pool->run(numChunks, [&](size_t chunk, size_t worker) {
+            std::vector<Point>& out = chunkResults[chunk];
+            for (size_t k = chunk * chunkSize; k < std::min(numQueries, (chunk + 1) * chunkSize); ++k) {
+                size_t q = order[k].second;
+                size_t before = out.size();
+                searchInto(queries[q], out, scratch[worker]);
+                result.offsets[q + 1] = out.size() - before;
             }
+        });
+
+        // Prefix sum of the counts, then copy every chunk into place in query order
+        for (size_t q = 0; q < numQueries; ++q) {
+            result.offsets[q + 1] += result.offsets[q];
         }
-        return results;
+        result.points.resize(result.offsets[numQueries]);
+        pool->run(numChunks, [&](size_t chunk, size_t) {
+            const Point* src = chunkResults[chunk].data();
+            for (size_t k = chunk * chunkSize; k < std::min(numQueries, (chunk + 1) * chunkSize); ++k) {
+                size_t q = order[k].second;
+                std::copy(src, src + result.count(q), result.points.begin() + result.offsets[q]);
+                src += result.count(q);
+            }
+        });
+        return result;
     }
     void printTree() {
         printNode(root, 0);
@@ -476,7 +963,7 @@ public:
             std::cout << std::endl;
         } else {
             std::cout << "Internal Node: ";
-            for (const auto& box : node->boxes) {
+            for (const auto& box : node->boxes.toVector()) {
                 std::cout << "[" << box.minX << ", " << box.minY << ", " << box.maxX << ", " << box.maxY << "] ";
             }
             std::cout << std::endl;
@@ -516,5 +1003,25 @@ int main() {
     }
     std::cout << std::endl;
 
+    // Perform a batch of searches
+    std::vector<BoundingBox> queries = {{0, 0, 3, 4}, {4, 5, 6, 7}, {9, 9, 12, 12}, {20, 20, 30, 30}};
+    BatchResult batch = rtree.searchBatch(queries);
+    std::cout << "\nBatch search results:" << std::endl;
+    for (size_t q = 0; q < queries.size(); ++q) {
+        std::cout << "Query " << q << ": " << batch.count(q) << " point(s) ";
+        for (const Point* p = batch.begin(q); p != batch.end(q); ++p) {
+            std::cout << "(" << p->x << ", " << p->y << ") ";
+        }
+        std::cout << std::endl;
+    }
+
+    // Move some points and remove others
+    rtree.update({2, 3}, {2.5, 3.5}); // Stays inside its leaf's box
+    rtree.update({10, 11}, {0, 0});   // Moves to another part of the tree
+    rtree.remove({5, 6});
+    rtree.remove({6, 7});
+    std::cout << "\nR-tree Structure after update/remove:" << std::endl;
+    rtree.printTree();
+
     return 0;
 }
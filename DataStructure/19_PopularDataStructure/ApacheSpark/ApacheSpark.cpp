@@ -1,73 +1,2252 @@
 #include <iostream>
 #include <vector>
+#include <deque>
 #include <thread>
 #include <functional>
 #include <mutex>
+#include <condition_variable>
+#include <atomic>
 #include <future>
+#include <memory>
+#include <string>
+#include <stdexcept>
+#include <exception>
+#include <type_traits>
+#include <utility>
+#include <optional>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <random>
+#include <list>
+#include <map>
+#include <ctime>
+#include <sstream>
+#include <iomanip>
+
+// Persistent pool of worker threads. run() hands each worker a contiguous block of
+// task indices in its own deque; a worker that runs out pops from the front of
+// another worker's deque, so a partition that turns out to be slow does not leave
+// the other threads idle.
+class WorkStealingPool {
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::mutex runMutex; // One run at a time when several threads submit jobs
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t)>* current = nullptr;
+    std::exception_ptr error; // First exception thrown by a task of the current run
+    std::atomic<size_t> remaining{0};
+    size_t generation = 0;
+    bool stopping = false;
+
+    bool popTask(size_t worker, size_t& task) {
+        {
+            TaskQueue& own = *queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < queues.size(); ++k) {
+            TaskQueue& victim = *queues[(worker + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t worker) {
+        size_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            size_t task;
+            while (popTask(worker, task)) {
+                // Read the function after the task: a worker still draining the last
+                // run may pick up a task of the next one
+                const std::function<void(size_t)>* fn;
+                bool skip;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    fn = current;
+                    skip = error != nullptr;
+                }
+                // Once a task has failed the job is lost: count the rest down unrun
+                if (!skip) {
+                    try {
+                        (*fn)(task);
+                    } catch (...) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (!error) error = std::current_exception();
+                    }
+                }
+                if (remaining.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done.notify_all();
+                }
+            }
+        }
+    }
+
+public:
+    explicit WorkStealingPool(size_t numThreads) {
+        if (numThreads == 0) numThreads = 1;
+        for (size_t i = 0; i < numThreads; ++i) {
+            queues.emplace_back(new TaskQueue());
+        }
+        for (size_t i = 0; i < numThreads; ++i) {
+            workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+        }
+    }
+
+    ~WorkStealingPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : workers) {
+            t.join();
+        }
+    }
+
+    size_t size() const { return workers.size(); }
+
+    // Run task(0) .. task(numTasks - 1) on the workers and wait for all of them.
+    // If a task throws, the tasks not started yet are skipped and the first
+    // exception is rethrown here. Must not be called from inside a task.
+    void run(size_t numTasks, const std::function<void(size_t)>& task) {
+        if (numTasks == 0) return;
+        std::lock_guard<std::mutex> runLock(runMutex);
+        std::unique_lock<std::mutex> lock(mutex);
+        current = &task;
+        remaining = numTasks;
+        for (size_t w = 0; w < queues.size(); ++w) {
+            std::lock_guard<std::mutex> queueLock(queues[w]->mutex);
+            for (size_t i = w * numTasks / queues.size(); i < (w + 1) * numTasks / queues.size(); ++i) {
+                queues[w]->tasks.push_back(i);
+            }
+        }
+        ++generation;
+        wake.notify_all();
+        done.wait(lock, [&] { return remaining == 0; });
+        current = nullptr;
+        std::exception_ptr failure = std::move(error);
+        error = nullptr;
+        if (failure) std::rethrow_exception(failure);
+    }
+};
+
+// Simple cluster manager to execute tasks in parallel. Owns one pool of executor
+// threads for the whole program, shared by every RDD action.
+class ClusterManager {
+public:
+    static WorkStealingPool& pool() {
+        static WorkStealingPool executors(std::max(1u, std::thread::hardware_concurrency()));
+        return executors;
+    }
+
+    // Default number of partitions for a new RDD: a few per thread, so that work
+    // stealing can even out partitions of uneven cost
+    static size_t defaultParallelism() {
+        return 4 * pool().size();
+    }
+
+    template <typename Func>
+    static void executeParallel(const std::vector<Func>& tasks) {
+        pool().run(tasks.size(), [&](size_t i) { tasks[i](); });
+    }
+
+    // Executor memory for shuffle buffers and sorting, shared evenly by the tasks
+    // running at the same time. Data beyond a task's share is spilled to disk.
+    static void setMemoryBudget(size_t bytes) {
+        memoryBudget() = bytes;
+    }
+
+    static std::atomic<size_t>& memoryBudget() {
+        static std::atomic<size_t> budget{size_t(1) << 30};
+        return budget;
+    }
+
+    static size_t taskMemoryBudget() {
+        return std::max<size_t>(memoryBudget() / pool().size(), 64 * 1024);
+    }
+
+    // Memory for the blocks of persisted RDDs (see BlockManager)
+    static void setStorageBudget(size_t bytes) {
+        storageBudget() = bytes;
+    }
+
+    static std::atomic<size_t>& storageBudget() {
+        static std::atomic<size_t> budget{size_t(1) << 30};
+        return budget;
+    }
+
+    // Total bytes written to spill files so far
+    static std::atomic<size_t>& spilledBytes() {
+        static std::atomic<size_t> bytes{0};
+        return bytes;
+    }
+};
+
+// CPU time used by the calling thread, in milliseconds
+inline double threadCpuMs() {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+#else
+    return 1e3 * std::clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+inline std::string jsonEscape(const std::string& text) {
+    std::string out;
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// What one task of a stage did. Records in are read from the stage's source (input
+// vector, file, shuffle or persisted block); records out are handed to the shuffle
+// or to the action.
+struct TaskMetrics {
+    size_t partition = 0;
+    size_t recordsIn = 0, recordsOut = 0;
+    size_t bytesRead = 0, bytesWritten = 0, spillBytes = 0;
+    double wallMs = 0, cpuMs = 0;
+};
+
+struct StageMetrics {
+    size_t id = 0;
+    std::string kind;     // "shuffle map", "sample" or "result"
+    std::string pipeline; // The fused operations, oldest first
+    double wallMs = 0;
+    std::vector<TaskMetrics> tasks;
+
+    TaskMetrics total() const {
+        TaskMetrics sum;
+        for (const TaskMetrics& task : tasks) {
+            sum.recordsIn += task.recordsIn;
+            sum.recordsOut += task.recordsOut;
+            sum.bytesRead += task.bytesRead;
+            sum.bytesWritten += task.bytesWritten;
+            sum.spillBytes += task.spillBytes;
+            sum.cpuMs += task.cpuMs;
+        }
+        return sum;
+    }
+
+    // Slowest task over the median task (1 = even). A high skew with even record
+    // counts points at expensive elements, with uneven counts at the partitioning.
+    double skew(size_t* slowest = nullptr) const {
+        if (tasks.empty()) {
+            return 1.0;
+        }
+        std::vector<double> wall;
+        size_t worst = 0;
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            wall.push_back(tasks[i].wallMs);
+            worst = tasks[i].wallMs > tasks[worst].wallMs ? i : worst;
+        }
+        std::nth_element(wall.begin(), wall.begin() + wall.size() / 2, wall.end());
+        if (slowest) {
+            *slowest = tasks[worst].partition;
+        }
+        double median = wall[wall.size() / 2];
+        return median > 0 ? tasks[worst].wallMs / median : 1.0;
+    }
+};
+
+struct JobMetrics {
+    size_t id = 0;
+    std::string action;
+    bool failed = false;
+    double wallMs = 0;
+    std::vector<StageMetrics> stages;
+
+    std::string toJson() const {
+        std::ostringstream out;
+        out << "{\"job\":" << id << ",\"action\":\"" << jsonEscape(action) << "\",\"failed\":"
+            << (failed ? "true" : "false") << ",\"wallMs\":" << wallMs << ",\"stages\":[";
+        for (size_t s = 0; s < stages.size(); ++s) {
+            const StageMetrics& stage = stages[s];
+            TaskMetrics sum = stage.total();
+            out << (s ? "," : "") << "{\"stage\":" << stage.id << ",\"kind\":\"" << stage.kind
+                << "\",\"pipeline\":\"" << jsonEscape(stage.pipeline) << "\",\"wallMs\":" << stage.wallMs
+                << ",\"cpuMs\":" << sum.cpuMs << ",\"recordsIn\":" << sum.recordsIn << ",\"recordsOut\":"
+                << sum.recordsOut << ",\"bytesRead\":" << sum.bytesRead << ",\"bytesWritten\":" << sum.bytesWritten
+                << ",\"spillBytes\":" << sum.spillBytes << ",\"skew\":" << stage.skew() << ",\"tasks\":[";
+            for (size_t t = 0; t < stage.tasks.size(); ++t) {
+                const TaskMetrics& task = stage.tasks[t];
+                out << (t ? "," : "") << "{\"partition\":" << task.partition << ",\"recordsIn\":" << task.recordsIn
+                    << ",\"recordsOut\":" << task.recordsOut << ",\"bytesRead\":" << task.bytesRead
+                    << ",\"bytesWritten\":" << task.bytesWritten << ",\"spillBytes\":" << task.spillBytes
+                    << ",\"wallMs\":" << task.wallMs << ",\"cpuMs\":" << task.cpuMs << "}";
+            }
+            out << "]}";
+        }
+        out << "]}";
+        return out.str();
+    }
+
+    // The stages in the order they ran, each one feeding the next through a shuffle
+    std::string toReport() const {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(2);
+        out << "Job " << id << " (" << action << (failed ? ", failed" : "") << "): " << stages.size() << " stages, "
+            << wallMs << " ms\n";
+        for (size_t s = 0; s < stages.size(); ++s) {
+            const StageMetrics& stage = stages[s];
+            TaskMetrics sum = stage.total();
+            size_t slowest = 0;
+            double skew = stage.skew(&slowest);
+            out << (s ? "   |\n   v\n" : "") << "  Stage " << stage.id << " [" << stage.kind << ", "
+                << stage.tasks.size() << " tasks] " << stage.pipeline << "\n"
+                << "    records " << sum.recordsIn << " in, " << sum.recordsOut << " out; bytes " << sum.bytesRead
+                << " read, " << sum.bytesWritten << " written, " << sum.spillBytes << " spilled\n"
+                << "    wall " << stage.wallMs << " ms, cpu " << sum.cpuMs << " ms; slowest partition " << slowest
+                << " at " << skew << "x the median" << (skew >= 2.0 && stage.wallMs >= 1.0 ? "  <-- skewed" : "") << "\n";
+        }
+        return out.str();
+    }
+};
+
+// Collects the metrics of every job (one per action) and the stages it ran. Tasks
+// update their own TaskMetrics through a thread-local pointer, so recording costs a
+// few additions per task and no locking. After each job the listener, if any, gets
+// the metrics, e.g. to print toReport() or store toJson().
+class JobProfiler {
+private:
+    std::mutex mutex;
+    size_t nextJob = 0, nextStage = 0;
+    int depth = 0; // Actions started by an action's own code belong to the outer job
+    JobMetrics job, last;
+    std::chrono::steady_clock::time_point jobStart;
+    std::function<void(const JobMetrics&)> listener;
+
+    static TaskMetrics*& current() {
+        thread_local TaskMetrics* task = nullptr;
+        return task;
+    }
+
+public:
+    static JobProfiler& instance() {
+        static JobProfiler profiler;
+        return profiler;
+    }
+
+    // Called on the driver thread after every action; must not throw
+    void setListener(std::function<void(const JobMetrics&)> onJobEnd) {
+        std::lock_guard<std::mutex> lock(mutex);
+        listener = std::move(onJobEnd);
+    }
+
+    JobMetrics lastJob() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return last;
+    }
+
+    void beginJob(const std::string& action) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (depth++ == 0) {
+            job = JobMetrics();
+            job.id = nextJob++;
+            job.action = action;
+            jobStart = std::chrono::steady_clock::now();
+        }
+    }
+
+    void endJob(bool failed) {
+        std::function<void(const JobMetrics&)> notify;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--depth > 0) {
+                return;
+            }
+            job.failed = failed;
+            job.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - jobStart).count();
+            last = std::move(job);
+            notify = listener;
+        }
+        if (notify) {
+            notify(last);
+        }
+    }
+
+    // Run one task per partition on the pool, timing each one
+    void runStage(const std::string& kind, const std::string& pipeline, size_t numTasks,
+                  const std::function<void(size_t)>& task) {
+        StageMetrics stage;
+        stage.kind = kind;
+        stage.pipeline = pipeline;
+        stage.tasks.resize(numTasks);
+        auto start = std::chrono::steady_clock::now();
+        ClusterManager::pool().run(numTasks, [&](size_t i) {
+            TaskMetrics& metrics = stage.tasks[i];
+            metrics.partition = i;
+            TaskMetrics* outer = current();
+            current() = &metrics;
+            auto taskStart = std::chrono::steady_clock::now();
+            double cpuStart = threadCpuMs();
+            task(i);
+            metrics.cpuMs = threadCpuMs() - cpuStart;
+            metrics.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - taskStart).count();
+            current() = outer;
+        });
+        stage.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        stage.id = nextStage++;
+        if (depth > 0) {
+            job.stages.push_back(std::move(stage));
+        }
+    }
+
+    // Called from inside tasks; no-ops outside of runStage
+    static void recordInput(size_t records, size_t bytes = 0) {
+        if (TaskMetrics* task = current()) {
+            task->recordsIn += records;
+            task->bytesRead += bytes;
+        }
+    }
+
+    static void recordOutput(size_t records, size_t bytes = 0) {
+        if (TaskMetrics* task = current()) {
+            task->recordsOut += records;
+            task->bytesWritten += bytes;
+        }
+    }
+
+    static void recordSpill(size_t bytes) {
+        if (TaskMetrics* task = current()) {
+            task->spillBytes += bytes;
+        }
+    }
+};
+
+// Marks the code of one action as a job for the JobProfiler
+class JobScope {
+private:
+    int uncaught = std::uncaught_exceptions();
+
+public:
+    explicit JobScope(const std::string& action) { JobProfiler::instance().beginJob(action); }
+    ~JobScope() { JobProfiler::instance().endJob(std::uncaught_exceptions() > uncaught); }
+
+    JobScope(const JobScope&) = delete;
+    JobScope& operator=(const JobScope&) = delete;
+};
+
+// Compact binary format for spilled records. Trivially copyable values are stored as
+// their bytes; strings and vectors as a varint length followed by their contents.
+inline void writeVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+inline const char* readVarint(const char* in, uint64_t& value) {
+    value = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t byte = (uint8_t)*in++;
+        value |= (uint64_t)(byte & 0x7f) << shift;
+        if (byte < 0x80) {
+            return in;
+        }
+    }
+}
+
+template <typename T>
+struct Serializer {
+    static_assert(std::is_trivially_copyable<T>::value, "spilled records need a Serializer specialization");
+
+    static void write(std::string& out, const T& value) {
+        out.append((const char*)&value, sizeof(T));
+    }
+
+    static const char* read(const char* in, T& value) {
+        std::memcpy(&value, in, sizeof(T));
+        return in + sizeof(T);
+    }
+};
+
+template <>
+struct Serializer<std::string> {
+    static void write(std::string& out, const std::string& value) {
+        writeVarint(out, value.size());
+        out.append(value);
+    }
+
+    static const char* read(const char* in, std::string& value) {
+        uint64_t size;
+        in = readVarint(in, size);
+        value.assign(in, size);
+        return in + size;
+    }
+};
+
+template <typename A, typename B>
+struct Serializer<std::pair<A, B>> {
+    static void write(std::string& out, const std::pair<A, B>& value) {
+        Serializer<A>::write(out, value.first);
+        Serializer<B>::write(out, value.second);
+    }
+
+    static const char* read(const char* in, std::pair<A, B>& value) {
+        return Serializer<B>::read(Serializer<A>::read(in, value.first), value.second);
+    }
+};
+
+template <typename A>
+struct Serializer<std::vector<A>> {
+    static void write(std::string& out, const std::vector<A>& value) {
+        writeVarint(out, value.size());
+        for (const A& element : value) {
+            Serializer<A>::write(out, element);
+        }
+    }
+
+    static const char* read(const char* in, std::vector<A>& value) {
+        uint64_t size;
+        in = readVarint(in, size);
+        value.resize(size);
+        for (A& element : value) {
+            in = Serializer<A>::read(in, element);
+        }
+        return in;
+    }
+};
+
+// Approximate heap footprint of a record, checked against the memory budget
+template <typename T>
+size_t estimateSize(const T&) {
+    return sizeof(T);
+}
+
+inline size_t estimateSize(const std::string& value) {
+    return sizeof(value) + value.capacity();
+}
+
+template <typename A>
+size_t estimateSize(const std::vector<A>& value);
+
+template <typename A, typename B>
+size_t estimateSize(const std::pair<A, B>& value) {
+    return estimateSize(value.first) + estimateSize(value.second);
+}
+
+template <typename A>
+size_t estimateSize(const std::vector<A>& value) {
+    size_t size = sizeof(value);
+    for (const A& element : value) {
+        size += estimateSize(element);
+    }
+    return size;
+}
+
+// fseek/ftell with 64-bit offsets: their long is 32 bits on Windows, so files over
+// 2 GB need _fseeki64/_ftelli64 there and fseeko/ftello elsewhere
+inline int seekFile(FILE* file, uint64_t offset, int origin) {
+#ifdef _WIN32
+    return _fseeki64(file, (__int64)offset, origin);
+#else
+    return fseeko(file, (off_t)offset, origin);
+#endif
+}
+
+inline int64_t tellFile(FILE* file) {
+#ifdef _WIN32
+    return _ftelli64(file);
+#else
+    return (int64_t)ftello(file);
+#endif
+}
+
+// Anonymous temporary file (std::tmpfile: removed when closed) holding spilled runs.
+// Runs are appended by one task and may then be read by several tasks at once.
+class SpillFile {
+private:
+    FILE* file;
+    std::mutex mutex;
+    size_t size = 0;
+
+public:
+    SpillFile() : file(std::tmpfile()) {
+        if (!file) {
+            throw std::runtime_error("cannot create a spill file");
+        }
+    }
+
+    ~SpillFile() { std::fclose(file); }
+
+    SpillFile(const SpillFile&) = delete;
+    SpillFile& operator=(const SpillFile&) = delete;
+
+    size_t getSize() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return size;
+    }
+
+    // Append bytes at the end of the file and return the offset they start at
+    size_t append(const std::string& bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t offset = size;
+        seekFile(file, offset, SEEK_SET);
+        if (std::fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size()) {
+            throw std::runtime_error("cannot write to a spill file");
+        }
+        size += bytes.size();
+        return offset;
+    }
+
+    size_t read(size_t offset, char* out, size_t length) {
+        std::lock_guard<std::mutex> lock(mutex);
+        seekFile(file, offset, SEEK_SET);
+        return std::fread(out, 1, length, file);
+    }
+};
+
+// Writes records to a spill file, each one prefixed with its 4-byte length, through
+// a buffer flushed every 1 MB. Only one writer may append to a file at a time, so
+// position() is the file offset the next record will be written at.
+template <typename T>
+class RunWriter {
+private:
+    static const size_t FLUSH_BYTES = 1 << 20;
+
+    std::shared_ptr<SpillFile> file;
+    std::string buffer;
+    size_t flushedTo;
+
+public:
+    explicit RunWriter(std::shared_ptr<SpillFile> spillFile)
+        : file(std::move(spillFile)), flushedTo(file->getSize()) {}
+
+    size_t position() const { return flushedTo + buffer.size(); }
+
+    void write(const T& record) {
+        size_t at = buffer.size();
+        buffer.append(4, '\0');
+        Serializer<T>::write(buffer, record);
+        uint32_t length = (uint32_t)(buffer.size() - at - 4);
+        std::memcpy(&buffer[at], &length, 4);
+        if (buffer.size() >= FLUSH_BYTES) {
+            flush();
+        }
+    }
+
+    // Must be called before the records are read back
+    void flush() {
+        if (!buffer.empty()) {
+            file->append(buffer);
+            ClusterManager::spilledBytes() += buffer.size();
+            JobProfiler::recordSpill(buffer.size());
+            flushedTo += buffer.size();
+            buffer.clear();
+        }
+    }
+};
+
+// Streams the records of byte range [begin, end) of a spill file back, 64 KB at a time
+template <typename T>
+class RunReader {
+private:
+    static constexpr size_t READ_BYTES = 64 * 1024;
+
+    std::shared_ptr<SpillFile> file;
+    size_t next, end;
+    std::vector<char> buffer;
+    size_t position = 0, filled = 0;
+
+    // Make sure `count` unread bytes are in the buffer
+    bool fill(size_t count) {
+        if (filled - position >= count) {
+            return true;
+        }
+        if (filled > position) {
+            // Not on an empty buffer: its data() may be null
+            std::memmove(buffer.data(), buffer.data() + position, filled - position);
+        }
+        filled -= position;
+        position = 0;
+        if (buffer.size() < std::max(count, READ_BYTES)) {
+            buffer.resize(std::max(count, READ_BYTES));
+        }
+        size_t wanted = std::min(buffer.size() - filled, end - next);
+        size_t got = wanted ? file->read(next, buffer.data() + filled, wanted) : 0;
+        next += got;
+        filled += got;
+        return filled - position >= count;
+    }
+
+public:
+    RunReader(std::shared_ptr<SpillFile> file, size_t begin, size_t end)
+        : file(std::move(file)), next(begin), end(end) {}
+
+    bool read(T& record) {
+        if (!fill(4)) {
+            return false;
+        }
+        uint32_t length;
+        std::memcpy(&length, buffer.data() + position, 4);
+        if (!fill(4 + (size_t)length)) {
+            throw std::runtime_error("truncated spill file");
+        }
+        Serializer<T>::read(buffer.data() + position + 4, record);
+        position += 4 + length;
+        return true;
+    }
+};
+
+// One step of an RDD's lineage: the operation that produced the RDD and the RDD it
+// was derived from. Kept so the plan can be printed without running it.
+struct LineageNode {
+    std::string operation;
+    std::shared_ptr<const LineageNode> parent;
+    bool shuffle = false; // Reads a shuffle, so a new stage starts here
+};
+
+// The operations fused into the stage that ends at `node`, oldest first: back to and
+// including the step that reads the previous shuffle
+inline std::string stagePipeline(const LineageNode* node) {
+    std::vector<const LineageNode*> steps;
+    for (; node; node = node->parent.get()) {
+        steps.push_back(node);
+        if (node->shuffle) {
+            break;
+        }
+    }
+    std::string pipeline;
+    for (size_t i = steps.size(); i-- > 0;) {
+        pipeline += steps[i]->operation + (i ? " -> " : "");
+    }
+    return pipeline;
+}
+
+enum StorageLevel {
+    MEMORY,            // The elements themselves: no cost to read, the most memory
+    MEMORY_SERIALIZED, // Serialized bytes in memory: compact, decoded on every read
+    DISK               // Serialized bytes in a file: no memory, read and decoded on every read
+};
+
+// Stores the partitions of persisted RDDs as blocks, one per (RDD id, partition).
+// Blocks held in memory share ClusterManager::storageBudget(). When a new block does
+// not fit, the least recently used blocks are dropped; their partitions are computed
+// again from the lineage the next time they are needed. DISK blocks are appended to
+// one spill file that is only reclaimed when the program exits.
+class BlockManager {
+public:
+    using BlockId = std::pair<uint64_t, size_t>;
+
+private:
+    struct Block {
+        StorageLevel level;
+        std::shared_ptr<const void> values;       // MEMORY: a std::vector<T>
+        std::shared_ptr<const std::string> bytes; // MEMORY_SERIALIZED
+        size_t offset = 0, length = 0;            // DISK: byte range in the file
+        size_t memory = 0;
+        std::list<BlockId>::iterator recent;
+    };
+
+    std::mutex mutex;
+    std::map<BlockId, Block> blocks;
+    std::list<BlockId> recentlyUsed; // Blocks in memory, most recently used first
+    size_t used = 0;
+    size_t evictions = 0;
+    std::shared_ptr<SpillFile> disk;
+    std::atomic<uint64_t> nextRddId{1};
+
+    // Called with the mutex held
+    void erase(std::map<BlockId, Block>::iterator it) {
+        if (it->second.level != DISK) {
+            recentlyUsed.erase(it->second.recent);
+            used -= it->second.memory;
+        }
+        blocks.erase(it);
+    }
+
+    void insert(const BlockId& id, Block block) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto existing = blocks.find(id);
+        if (existing != blocks.end()) {
+            erase(existing);
+        }
+        if (block.level != DISK) {
+            size_t budget = ClusterManager::storageBudget();
+            if (block.memory > budget) {
+                return;
+            }
+            while (used + block.memory > budget) {
+                erase(blocks.find(recentlyUsed.back()));
+                ++evictions;
+            }
+            recentlyUsed.push_front(id);
+            block.recent = recentlyUsed.begin();
+            used += block.memory;
+        }
+        blocks.emplace(id, std::move(block));
+    }
+
+public:
+    static BlockManager& instance() {
+        static BlockManager manager;
+        return manager;
+    }
+
+    uint64_t newRddId() { return nextRddId++; }
+
+    // The partition stored under id, or nullptr when it is not (or no longer) stored
+    template <typename T>
+    std::shared_ptr<const std::vector<T>> getBlock(const BlockId& id) {
+        Block block;
+        std::shared_ptr<SpillFile> file;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = blocks.find(id);
+            if (it == blocks.end()) {
+                return nullptr;
+            }
+            if (it->second.level != DISK) {
+                recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, it->second.recent);
+            }
+            block = it->second;
+            file = disk;
+        }
+        if (block.level == MEMORY) {
+            return std::static_pointer_cast<const std::vector<T>>(block.values);
+        }
+        std::string diskBytes;
+        const std::string* bytes = block.bytes.get();
+        if (block.level == DISK) {
+            diskBytes.resize(block.length);
+            file->read(block.offset, &diskBytes[0], block.length);
+            bytes = &diskBytes;
+        }
+        auto values = std::make_shared<std::vector<T>>();
+        Serializer<std::vector<T>>::read(bytes->data(), *values);
+        return values;
+    }
+
+    void putBlock(const BlockId& id, StorageLevel level, std::shared_ptr<const void> values, size_t memory) {
+        Block block;
+        block.level = level;
+        block.values = std::move(values);
+        block.memory = memory;
+        insert(id, std::move(block));
+    }
+
+    template <typename T>
+    void putBlock(const BlockId& id, StorageLevel level, const std::shared_ptr<const std::vector<T>>& values) {
+        if (level == MEMORY) {
+            putBlock(id, level, values, estimateSize(*values));
+            return;
+        }
+        auto bytes = std::make_shared<std::string>();
+        Serializer<std::vector<T>>::write(*bytes, *values);
+        Block block;
+        block.level = level;
+        if (level == MEMORY_SERIALIZED) {
+            block.memory = bytes->size();
+            block.bytes = std::move(bytes);
+        } else {
+            std::shared_ptr<SpillFile> file;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!disk) {
+                    disk = std::make_shared<SpillFile>();
+                }
+                file = disk;
+            }
+            block.offset = file->append(*bytes);
+            block.length = bytes->size();
+        }
+        insert(id, std::move(block));
+    }
+
+    // Drop every block of an RDD
+    void remove(uint64_t rddId) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = blocks.lower_bound(BlockId(rddId, 0));
+        while (it != blocks.end() && it->first.first == rddId) {
+            erase(it++);
+        }
+    }
+
+    size_t memoryUsed() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return used;
+    }
+
+    size_t getEvictions() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return evictions;
+    }
+};
+
+// The blocks of one persisted RDD. They are dropped from the BlockManager when the
+// last RDD reading them is destroyed, or earlier by unpersist().
+struct PersistedBlocks {
+    const uint64_t rddId;
+    const StorageLevel level;
+    std::atomic<bool> active{true};
+
+    PersistedBlocks(uint64_t rddId, StorageLevel level) : rddId(rddId), level(level) {}
+    ~PersistedBlocks() { BlockManager::instance().remove(rddId); }
+
+    PersistedBlocks(const PersistedBlocks&) = delete;
+    PersistedBlocks& operator=(const PersistedBlocks&) = delete;
+};
+
+// Read-only view of the elements of an RDD, partition after partition. It shares the
+// partitions it reads instead of copying them into one vector, and keeps them alive
+// after the RDD and its blocks are gone.
+template <typename T>
+class PartitionedView {
+private:
+    std::vector<std::shared_ptr<const std::vector<T>>> parts;
+    std::vector<size_t> offsets; // Index of the first element of every partition
+    size_t total = 0;
+
+public:
+    class iterator {
+    private:
+        const PartitionedView* view;
+        size_t part, index;
+
+        void skipEmpty() {
+            while (part < view->parts.size() && index == view->parts[part]->size()) {
+                ++part;
+                index = 0;
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const T*;
+        using reference = const T&;
+
+        iterator(const PartitionedView* view, size_t part) : view(view), part(part), index(0) { skipEmpty(); }
+
+        const T& operator*() const { return (*view->parts[part])[index]; }
+        const T* operator->() const { return &**this; }
+
+        iterator& operator++() {
+            ++index;
+            skipEmpty();
+            return *this;
+        }
+
+        iterator operator++(int) {
+            iterator old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==(const iterator& other) const { return part == other.part && index == other.index; }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+    };
+
+    explicit PartitionedView(std::vector<std::shared_ptr<const std::vector<T>>> partitions)
+        : parts(std::move(partitions)) {
+        for (const auto& part : parts) {
+            offsets.push_back(total);
+            total += part->size();
+        }
+    }
+
+    size_t size() const { return total; }
+    bool empty() const { return total == 0; }
+
+    const T& operator[](size_t i) const {
+        size_t p = std::upper_bound(offsets.begin(), offsets.end(), i) - offsets.begin() - 1;
+        return (*parts[p])[i - offsets[p]];
+    }
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, parts.size()); }
+
+    const std::vector<std::shared_ptr<const std::vector<T>>>& partitions() const { return parts; }
+
+    std::vector<T> toVector() const { return std::vector<T>(begin(), end()); }
+};
+
+// Reads a file sequentially from a starting offset through a 1 MB buffer, for the
+// file-backed RDD sources. Every task opens its own reader, so partitions of one file
+// are read in parallel and only one buffer per task is in memory.
+class FileChunkReader {
+private:
+    static constexpr size_t READ_BYTES = 1 << 20;
+
+    FILE* file;
+    std::vector<char> buffer;
+    size_t position = 0, filled = 0;
+    size_t offset; // File offset of buffer[0]
+
+    // Move the unread bytes to the front and read more; false at the end of the file
+    bool refill() {
+        std::memmove(buffer.data(), buffer.data() + position, filled - position);
+        offset += position;
+        filled -= position;
+        position = 0;
+        if (buffer.size() - filled < READ_BYTES) {
+            buffer.resize(filled + READ_BYTES);
+        }
+        size_t got = std::fread(buffer.data() + filled, 1, buffer.size() - filled, file);
+        filled += got;
+        return got > 0;
+    }
+
+public:
+    // The buffer is allocated up front, so memmove and memchr never see the null
+    // data() of an empty vector
+    FileChunkReader(const std::string& path, size_t start)
+        : file(std::fopen(path.c_str(), "rb")), buffer(READ_BYTES), offset(start) {
+        if (!file || seekFile(file, start, SEEK_SET) != 0) {
+            if (file) {
+                std::fclose(file);
+            }
+            throw std::runtime_error("cannot read " + path);
+        }
+    }
+
+    ~FileChunkReader() { std::fclose(file); }
+
+    FileChunkReader(const FileChunkReader&) = delete;
+    FileChunkReader& operator=(const FileChunkReader&) = delete;
+
+    static size_t sizeOf(const std::string& path) {
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (!file) {
+            throw std::runtime_error("cannot open " + path);
+        }
+        seekFile(file, 0, SEEK_END);
+        int64_t size = tellFile(file);
+        std::fclose(file);
+        return (size_t)size;
+    }
+
+    // The next line without its line ending, and the file offset it starts at. The
+    // last line of the file does not need a line ending.
+    bool nextLine(std::string& line, size_t& lineStart) {
+        size_t scanned = position;
+        while (true) {
+            const char* newline = (const char*)std::memchr(buffer.data() + scanned, '\n', filled - scanned);
+            if (newline) {
+                size_t length = newline - (buffer.data() + position);
+                lineStart = offset + position;
+                line.assign(buffer.data() + position, length > 0 && newline[-1] == '\r' ? length - 1 : length);
+                position += length + 1;
+                return true;
+            }
+            scanned = filled - position;
+            if (!refill()) {
+                if (position == filled) {
+                    return false;
+                }
+                lineStart = offset + position;
+                line.assign(buffer.data() + position, filled - position);
+                position = filled;
+                return true;
+            }
+        }
+    }
+
+    // The next recordSize bytes; false when fewer are left
+    bool nextRecord(std::string& record, size_t recordSize) {
+        while (filled - position < recordSize) {
+            if (!refill()) {
+                return false;
+            }
+        }
+        record.assign(buffer.data() + position, recordSize);
+        position += recordSize;
+        return true;
+    }
+};
+
+// Split one CSV line into its fields. Fields may be quoted, and a quote inside a
+// quoted field is written twice. Quoted line breaks are not supported, since
+// textFile splits the file at every line break.
+inline std::vector<std::string> splitCsvLine(const std::string& line, char separator = ',') {
+    std::vector<std::string> fields(1);
+    bool quoted = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c != '"') {
+                fields.back() += c;
+            } else if (i + 1 < line.size() && line[i + 1] == '"') {
+                fields.back() += '"';
+                ++i;
+            } else {
+                quoted = false;
+            }
+        } else if (c == '"') {
+            quoted = true;
+        } else if (c == separator) {
+            fields.emplace_back();
+        } else {
+            fields.back() += c;
+        }
+    }
+    return fields;
+}
+
+// Numeric RDDs also run in columnar form: a task hands its partition over in batches
+// of up to BATCH_SIZE values instead of one std::function call per element. Only the
+// values listed in the selection vector belong to the RDD; a batch without one
+// (selection == nullptr) is dense. Filters only write a new selection vector, and
+// maps compact the selected values into a dense output column.
+const size_t BATCH_SIZE = 2048;
+
+template <typename T>
+constexpr bool isColumnar = std::is_arithmetic<T>::value && !std::is_same<T, bool>::value;
+
+template <typename T>
+struct ColumnBatch {
+    const T* values;
+    size_t size;
+    const uint16_t* selection; // Indices into values, or nullptr when all of them are selected
+    size_t selected;
+
+    T at(size_t k) const { return selection ? values[selection[k]] : values[k]; }
+};
+
+// Column kernels. The function is a template argument, so it is inlined into a plain
+// loop over the column that the compiler can vectorize. Only selected values are
+// passed to the function: a filter may have removed the ones it is not defined for.
+template <typename T, typename U, typename Func>
+void mapColumn(const ColumnBatch<T>& batch, const Func& func, U* out) {
+    if (!batch.selection) {
+        for (size_t i = 0; i < batch.size; ++i) {
+            out[i] = func(batch.values[i]);
+        }
+    } else {
+        for (size_t k = 0; k < batch.selected; ++k) {
+            out[k] = func(batch.values[batch.selection[k]]);
+        }
+    }
+}
+
+// Branch-free: every candidate index is written, and the output position only moves
+// on when the condition holds
+template <typename T, typename Func>
+size_t filterColumn(const ColumnBatch<T>& batch, const Func& condition, uint16_t* selection) {
+    size_t n = 0;
+    if (!batch.selection) {
+        for (size_t i = 0; i < batch.size; ++i) {
+            selection[n] = (uint16_t)i;
+            n += condition(batch.values[i]) ? 1 : 0;
+        }
+    } else {
+        for (size_t k = 0; k < batch.selected; ++k) {
+            uint16_t i = batch.selection[k];
+            selection[n] = i;
+            n += condition(batch.values[i]) ? 1 : 0;
+        }
+    }
+    return n;
+}
+
+// Fold the selected values from position `first` on into acc
+template <typename T, typename Func>
+T foldColumn(const ColumnBatch<T>& batch, const Func& op, T acc, size_t first) {
+    if (!batch.selection) {
+        for (size_t i = first; i < batch.size; ++i) {
+            acc = op(acc, batch.values[i]);
+        }
+    } else {
+        for (size_t k = first; k < batch.selected; ++k) {
+            acc = op(acc, batch.values[batch.selection[k]]);
+        }
+    }
+    return acc;
+}
+
+template <typename K, typename V>
+class PairRDD;
 
 // Simple abstraction of an RDD
+//
+// The data is split into partitions, and every action runs one task per partition on
+// the ClusterManager's pool.
+//
+// Transformations are lazy, as in Spark: map and filter only record a step in the
+// lineage and compose a function. Nothing runs until an action (collect, reduce,
+// count). Each task then pulls the elements of its partition through the whole
+// map/filter chain in a single pass, so a chain of N transformations makes no
+// intermediate vectors. Numeric RDDs read from a vector run the chain on ColumnBatches
+// (computeBatches) until the first step that leaves the numeric types.
+//
+// A shuffle (see PairRDD) splits a job into stages. The map side of a shuffle has to
+// finish before any task after it can start, so it is run by prepareStages() from the
+// driver thread before the action's own tasks.
 template <typename T>
 class RDD {
-private:
-    std::vector<T> data;
+public:
+    // Receives the elements of a partition one at a time
+    using Consumer = std::function<void(const T&)>;
+
+    // Pushes every element of one partition, in order, into a consumer
+    using Compute = std::function<void(size_t partition, const Consumer&)>;
+
+    // Columnar form of Compute: the same elements, a batch at a time
+    using BatchConsumer = std::function<void(const ColumnBatch<T>&)>;
+    using ComputeBatches = std::function<void(size_t partition, const BatchConsumer&)>;
+
+protected:
+    Compute compute;
+    size_t numPartitions;
+    std::shared_ptr<const LineageNode> lineage;
+
+    // Runs the shuffle stages this RDD depends on, if they have not run yet
+    std::function<void()> prepareStages;
+
+    // Set only for numeric RDDs whose whole chain can run on batches
+    ComputeBatches computeBatches;
+
+    // Set only on the RDD returned by persist(): partition p, read from its block
+    std::function<std::shared_ptr<const std::vector<T>>(size_t partition)> readBlock;
+    std::shared_ptr<PersistedBlocks> persisted;
+
+    template <typename U>
+    friend class RDD;
+
+    template <typename K, typename V>
+    friend class PairRDD;
+
+    // A columnar RDD passes compute = nullptr; the element form is then derived from
+    // its batches
+    RDD(Compute compute, size_t numPartitions, std::shared_ptr<const LineageNode> lineage,
+        std::function<void()> prepareStages = nullptr, ComputeBatches computeBatches = nullptr)
+        : compute(std::move(compute)), numPartitions(numPartitions), lineage(std::move(lineage)),
+          prepareStages(std::move(prepareStages)), computeBatches(std::move(computeBatches)) {
+        if (!this->compute) {
+            this->compute = elementsOf(this->computeBatches);
+        }
+    }
+
+    static Compute elementsOf(ComputeBatches batches) {
+        return [batches](size_t partition, const Consumer& consumer) {
+            batches(partition, [&](const ColumnBatch<T>& batch) {
+                for (size_t k = 0; k < batch.selected; ++k) {
+                    consumer(batch.at(k));
+                }
+            });
+        };
+    }
+
+    static size_t fileSplits(size_t fileSize, size_t numPartitions) {
+        const size_t SPLIT_BYTES = size_t(64) << 20;
+        if (numPartitions) {
+            return numPartitions;
+        }
+        return std::max(ClusterManager::defaultParallelism(), (fileSize + SPLIT_BYTES - 1) / SPLIT_BYTES);
+    }
+
+    std::shared_ptr<const LineageNode> derive(const std::string& operation, bool shuffle = false) const {
+        return std::make_shared<const LineageNode>(LineageNode{operation, lineage, shuffle});
+    }
+
+    // Run one task per partition on the pool, after the stages this RDD depends on.
+    // Called once per action, inside the action's JobScope.
+    void forEachPartition(const std::string& action, const std::function<void(size_t partition)>& task) const {
+        if (prepareStages) {
+            prepareStages();
+        }
+        JobProfiler::instance().runStage("result", stagePipeline(lineage.get()) + " -> " + action, numPartitions, task);
+    }
 
 public:
-    // Constructor
-    RDD(const std::vector<T>& inputData) : data(inputData) {}
+    // Constructor: the input is copied once, shared by every RDD derived from it, and
+    // split into numPartitions contiguous ranges (0 = ClusterManager::defaultParallelism)
+    RDD(const std::vector<T>& inputData, size_t numPartitions = 0)
+        : RDD(std::vector<T>(inputData), numPartitions) {}
+
+    RDD(std::vector<T>&& inputData, size_t partitions = 0) {
+        auto source = std::make_shared<const std::vector<T>>(std::move(inputData));
+        numPartitions = partitions ? partitions : ClusterManager::defaultParallelism();
+        size_t count = numPartitions;
+        if constexpr (isColumnar<T>) {
+            // Batches point straight into the shared input
+            computeBatches = [source, count](size_t partition, const BatchConsumer& consumer) {
+                size_t begin = partition * source->size() / count;
+                size_t end = (partition + 1) * source->size() / count;
+                JobProfiler::recordInput(end - begin);
+                for (size_t i = begin; i < end; i += BATCH_SIZE) {
+                    size_t size = std::min(BATCH_SIZE, end - i);
+                    consumer(ColumnBatch<T>{source->data() + i, size, nullptr, size});
+                }
+            };
+            compute = elementsOf(computeBatches);
+        } else {
+            compute = [source, count](size_t partition, const Consumer& consumer) {
+                size_t begin = partition * source->size() / count;
+                size_t end = (partition + 1) * source->size() / count;
+                JobProfiler::recordInput(end - begin);
+                for (size_t i = begin; i < end; ++i) {
+                    consumer((*source)[i]);
+                }
+            };
+        }
+        lineage = std::make_shared<const LineageNode>(LineageNode{"parallelize (" + std::to_string(source->size())
+            + " elements, " + std::to_string(numPartitions) + " partitions)", nullptr});
+    }
+
+    // Source: TextFile (The lines of a text file, without their line endings). The file
+    // is split into numPartitions byte ranges (0 = defaultParallelism, or more so that a
+    // range is at most 64 MB), and a line belongs to the range its first byte is in.
+    // Nothing is read here: every action streams each range from the file again, one
+    // line at a time, so the file never has to fit in memory.
+    static RDD<std::string> textFile(const std::string& path, size_t numPartitions = 0) {
+        size_t size = FileChunkReader::sizeOf(path);
+        size_t count = fileSplits(size, numPartitions);
+        return RDD<std::string>([path, size, count](size_t partition, const typename RDD<std::string>::Consumer& consumer) {
+            size_t begin = partition * size / count;
+            size_t end = (partition + 1) * size / count;
+            if (begin == end) {
+                return;
+            }
+            // Start one byte early: the rest of the line holding that byte belongs to
+            // the previous range (and is empty when the range starts a line)
+            FileChunkReader reader(path, begin > 0 ? begin - 1 : 0);
+            std::string line;
+            size_t lineStart;
+            if (begin > 0) {
+                reader.nextLine(line, lineStart);
+            }
+            size_t lines = 0;
+            while (reader.nextLine(line, lineStart) && lineStart < end) {
+                ++lines;
+                consumer(line);
+            }
+            JobProfiler::recordInput(lines, end - begin);
+        }, count, std::make_shared<const LineageNode>(LineageNode{"textFile " + path + " (" + std::to_string(size)
+            + " bytes, " + std::to_string(count) + " partitions)", nullptr}));
+    }
+
+    // Source: BinaryRecords (A file of fixed-size records, each one as a string of
+    // recordSize bytes). Split and streamed like textFile, on record boundaries.
+    static RDD<std::string> binaryRecords(const std::string& path, size_t recordSize, size_t numPartitions = 0) {
+        size_t size = FileChunkReader::sizeOf(path);
+        if (recordSize == 0 || size % recordSize != 0) {
+            throw std::runtime_error(path + " is not made of " + std::to_string(recordSize) + "-byte records");
+        }
+        size_t records = size / recordSize;
+        size_t count = fileSplits(size, numPartitions);
+        return RDD<std::string>([path, recordSize, records, count](size_t partition,
+                                                                    const typename RDD<std::string>::Consumer& consumer) {
+            size_t begin = partition * records / count;
+            size_t end = (partition + 1) * records / count;
+            if (begin == end) {
+                return;
+            }
+            FileChunkReader reader(path, begin * recordSize);
+            std::string record;
+            JobProfiler::recordInput(end - begin, (end - begin) * recordSize);
+            for (size_t i = begin; i < end && reader.nextRecord(record, recordSize); ++i) {
+                consumer(record);
+            }
+        }, count, std::make_shared<const LineageNode>(LineageNode{"binaryRecords " + path + " (" + std::to_string(records)
+            + " records, " + std::to_string(count) + " partitions)", nullptr}));
+    }
+
+    size_t getNumPartitions() const { return numPartitions; }
 
     // Transformation: Map (Apply a function to each element)
     template <typename Func>
-    auto map(Func func) {
-        std::vector<decltype(func(data[0]))> mappedData;
-        for (const auto& element : data) {
-            mappedData.push_back(func(element));
+    auto map(Func func) const {
+        using U = std::decay_t<decltype(func(std::declval<const T&>()))>;
+        if constexpr (isColumnar<T>) {
+            if (computeBatches) {
+                ComputeBatches parent = computeBatches;
+                if constexpr (isColumnar<U>) {
+                    return RDD<U>(nullptr, numPartitions, derive("map"), prepareStages,
+                                  [parent, func](size_t partition, const typename RDD<U>::BatchConsumer& consumer) {
+                        U out[BATCH_SIZE];
+                        parent(partition, [&](const ColumnBatch<T>& batch) {
+                            mapColumn(batch, func, out);
+                            consumer(ColumnBatch<U>{out, batch.selected, nullptr, batch.selected});
+                        });
+                    });
+                } else {
+                    // Leaves the numeric types: batches in, elements out
+                    return RDD<U>([parent, func](size_t partition, const typename RDD<U>::Consumer& consumer) {
+                        parent(partition, [&](const ColumnBatch<T>& batch) {
+                            for (size_t k = 0; k < batch.selected; ++k) {
+                                consumer(func(batch.at(k)));
+                            }
+                        });
+                    }, numPartitions, derive("map"), prepareStages);
+                }
+            }
         }
-        return RDD<decltype(func(data[0]))>(mappedData);
+        Compute parent = compute;
+        return RDD<U>([parent, func](size_t partition, const typename RDD<U>::Consumer& consumer) {
+            parent(partition, [&](const T& element) { consumer(func(element)); });
+        }, numPartitions, derive("map"), prepareStages);
     }
 
     // Transformation: Filter (Filter elements based on a condition)
     template <typename Func>
-    RDD filter(Func condition) {
-        std::vector<T> filteredData;
-        for (const auto& element : data) {
-            if (condition(element)) {
-                filteredData.push_back(element);
+    RDD filter(Func condition) const {
+        if constexpr (isColumnar<T>) {
+            if (computeBatches) {
+                ComputeBatches parent = computeBatches;
+                return RDD(nullptr, numPartitions, derive("filter"), prepareStages,
+                           [parent, condition](size_t partition, const BatchConsumer& consumer) {
+                    uint16_t selection[BATCH_SIZE];
+                    parent(partition, [&](const ColumnBatch<T>& batch) {
+                        size_t selected = filterColumn(batch, condition, selection);
+                        if (selected) {
+                            consumer(ColumnBatch<T>{batch.values, batch.size, selection, selected});
+                        }
+                    });
+                });
+            }
+        }
+        Compute parent = compute;
+        return RDD([parent, condition](size_t partition, const Consumer& consumer) {
+            parent(partition, [&](const T& element) {
+                if (condition(element)) {
+                    consumer(element);
+                }
+            });
+        }, numPartitions, derive("filter"), prepareStages);
+    }
+
+    // Transformation: SortBy (Order the elements by a key; defined after PairRDD)
+    template <typename Func>
+    RDD sortBy(Func keyFunc, bool ascending = true, size_t numPartitions = 0) const;
+
+    // Persist (Keep the partitions of this RDD once an action has computed them). The
+    // RDD returned, and every RDD derived from it, reads them from the BlockManager
+    // instead of running the lineage again; a partition whose block was evicted is
+    // recomputed. Elements need a Serializer for MEMORY_SERIALIZED and DISK.
+    RDD persist(StorageLevel level = MEMORY) const {
+        auto blocks = std::make_shared<PersistedBlocks>(BlockManager::instance().newRddId(), level);
+        Compute parent = compute;
+        auto read = [blocks, parent](size_t partition) -> std::shared_ptr<const std::vector<T>> {
+            BlockManager& manager = BlockManager::instance();
+            BlockManager::BlockId id(blocks->rddId, partition);
+            if (std::shared_ptr<const std::vector<T>> block = manager.getBlock<T>(id)) {
+                JobProfiler::recordInput(block->size());
+                return block;
+            }
+            auto values = std::make_shared<std::vector<T>>();
+            parent(partition, [&](const T& element) { values->push_back(element); });
+            if (blocks->active) {
+                manager.putBlock<T>(id, blocks->level, values);
+            }
+            return values;
+        };
+
+        static const char* const LEVEL_NAMES[] = {"MEMORY", "MEMORY_SERIALIZED", "DISK"};
+        std::shared_ptr<const LineageNode> node = derive(std::string("persist (") + LEVEL_NAMES[level] + ")");
+        RDD result = [&]() {
+            if constexpr (isColumnar<T>) {
+                return RDD(nullptr, numPartitions, node, prepareStages,
+                           [read](size_t partition, const BatchConsumer& consumer) {
+                    std::shared_ptr<const std::vector<T>> block = read(partition);
+                    for (size_t i = 0; i < block->size(); i += BATCH_SIZE) {
+                        size_t size = std::min(BATCH_SIZE, block->size() - i);
+                        consumer(ColumnBatch<T>{block->data() + i, size, nullptr, size});
+                    }
+                });
+            } else {
+                return RDD([read](size_t partition, const Consumer& consumer) {
+                    std::shared_ptr<const std::vector<T>> block = read(partition);
+                    for (const T& element : *block) {
+                        consumer(element);
+                    }
+                }, numPartitions, node, prepareStages);
+            }
+        }();
+        result.readBlock = read;
+        result.persisted = blocks;
+        return result;
+    }
+
+    RDD cache() const { return persist(MEMORY); }
+
+    // Drop the stored partitions and stop storing new ones
+    void unpersist() const {
+        if (persisted) {
+            persisted->active = false;
+            BlockManager::instance().remove(persisted->rddId);
+        }
+    }
+
+    // Action: CollectView (All elements, partition by partition, without concatenating
+    // them). The partitions of a persisted RDD are shared with its blocks, not copied.
+    PartitionedView<T> collectView() const {
+        JobScope job("collectView");
+        std::vector<std::shared_ptr<const std::vector<T>>> parts(numPartitions);
+        forEachPartition("collectView", [&](size_t p) {
+            if (readBlock) {
+                parts[p] = readBlock(p);
+            } else {
+                auto part = std::make_shared<std::vector<T>>();
+                compute(p, [&](const T& element) { part->push_back(element); });
+                parts[p] = std::move(part);
             }
+            JobProfiler::recordOutput(parts[p]->size());
+        });
+        return PartitionedView<T>(std::move(parts));
+    }
+
+    // Action: Collect (Retrieve all data as a vector, in partition order)
+    std::vector<T> collect() const {
+        JobScope job("collect");
+        std::vector<std::vector<T>> parts(numPartitions);
+        forEachPartition("collect", [&](size_t p) {
+            if (computeBatches) {
+                computeBatches(p, [&](const ColumnBatch<T>& batch) {
+                    if (!batch.selection) {
+                        parts[p].insert(parts[p].end(), batch.values, batch.values + batch.size);
+                        return;
+                    }
+                    size_t at = parts[p].size();
+                    parts[p].resize(at + batch.selected);
+                    for (size_t k = 0; k < batch.selected; ++k) {
+                        parts[p][at + k] = batch.values[batch.selection[k]];
+                    }
+                });
+            } else {
+                compute(p, [&](const T& element) { parts[p].push_back(element); });
+            }
+            JobProfiler::recordOutput(parts[p].size());
+        });
+
+        // Concatenate in parallel: every partition knows where its output starts
+        std::vector<size_t> offsets(numPartitions + 1, 0);
+        for (size_t p = 0; p < numPartitions; ++p) {
+            offsets[p + 1] = offsets[p] + parts[p].size();
         }
-        return RDD(filteredData);
+        std::vector<T> result(offsets[numPartitions]);
+        ClusterManager::pool().run(numPartitions, [&](size_t p) {
+            std::move(parts[p].begin(), parts[p].end(), result.begin() + offsets[p]);
+        });
+        return result;
     }
 
-    // Action: Collect (Retrieve all data as a vector)
-    std::vector<T> collect() {
-        return data;
+    // Action: Count (Number of elements)
+    size_t count() const {
+        JobScope job("count");
+        std::vector<size_t> counts(numPartitions, 0);
+        forEachPartition("count", [&](size_t p) {
+            if (computeBatches) {
+                computeBatches(p, [&](const ColumnBatch<T>& batch) { counts[p] += batch.selected; });
+            } else {
+                compute(p, [&](const T&) { ++counts[p]; });
+            }
+            JobProfiler::recordOutput(counts[p]);
+        });
+        size_t total = 0;
+        for (size_t c : counts) {
+            total += c;
+        }
+        return total;
     }
 
     // Action: Reduce (Aggregate data with a binary operation)
+    //
+    // Each partition is folded by its own task, then the partial results are combined
+    // pairwise as a tree: level k combines results 2^k apart, in parallel, so P
+    // partitions need log2(P) levels instead of a serial pass. Partitions are always
+    // combined left with right, so the operation only has to be associative.
     template <typename Func>
-    T reduce(Func binaryOp) {
-        T result = data[0];
-        for (size_t i = 1; i < data.size(); ++i) {
-            result = binaryOp(result, data[i]);
+    T reduce(Func binaryOp) const {
+        JobScope job("reduce");
+        std::vector<std::optional<T>> partial(numPartitions);
+        forEachPartition("reduce", [&](size_t p) {
+            size_t folded = 0;
+            if (computeBatches) {
+                computeBatches(p, [&](const ColumnBatch<T>& batch) {
+                    if (batch.selected == 0) {
+                        return;
+                    }
+                    size_t first = 0;
+                    if (!partial[p]) {
+                        partial[p] = batch.at(0);
+                        first = 1;
+                    }
+                    partial[p] = foldColumn(batch, binaryOp, *partial[p], first);
+                    folded += batch.selected;
+                });
+            } else {
+                compute(p, [&](const T& element) {
+                    partial[p] = partial[p] ? binaryOp(*partial[p], element) : element;
+                    ++folded;
+                });
+            }
+            JobProfiler::recordOutput(folded);
+        });
+
+        for (size_t stride = 1; stride < numPartitions; stride *= 2) {
+            size_t pairs = (numPartitions + 2 * stride - 1) / (2 * stride);
+            ClusterManager::pool().run(pairs, [&](size_t k) {
+                size_t left = 2 * stride * k, right = left + stride;
+                if (right >= numPartitions || !partial[right]) {
+                    return;
+                }
+                partial[left] = partial[left] ? binaryOp(*partial[left], *partial[right]) : partial[right];
+            });
         }
-        return result;
+        if (numPartitions == 0 || !partial[0]) {
+            throw std::runtime_error("reduce of an empty RDD");
+        }
+        return *partial[0];
+    }
+
+    // The lineage of this RDD, newest step first, like Spark's toDebugString
+    std::string toDebugString() const {
+        std::string text;
+        std::string indent;
+        for (const LineageNode* node = lineage.get(); node; node = node->parent.get()) {
+            text += indent + node->operation + "\n";
+            indent += "  ";
+        }
+        return text;
     }
 };
 
-// Simple cluster manager to execute tasks in parallel
-class ClusterManager {
+// Spreads std::hash values (the identity for integers) over all 64 bits. The high
+// half picks the shuffle partition and the low half the FlatHashMap slot, so the keys
+// of one partition do not all land in the same slots.
+template <typename K>
+uint64_t hashKey(const K& key) {
+    uint64_t h = std::hash<K>{}(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Shuffle partition of a key: hash partitioning, as Spark's HashPartitioner
+template <typename K>
+size_t partitionOf(const K& key, size_t numPartitions) {
+    return (size_t)(((hashKey(key) >> 32) * numPartitions) >> 32);
+}
+
+// Open-addressing hash map (linear probing) on flat arrays, used to combine records
+// by key. Inserting a key allocates nothing by itself, and when the number of
+// records is known up front the table is sized once with reserve().
+template <typename K, typename V>
+class FlatHashMap {
+private:
+    std::vector<K> keys;
+    std::vector<V> values;
+    std::vector<uint8_t> used;
+    size_t count = 0;
+
+    size_t slotOf(const K& key) const {
+        size_t mask = keys.size() - 1;
+        size_t slot = (size_t)hashKey(key) & mask;
+        while (used[slot] && !(keys[slot] == key)) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void rehash(size_t capacity) {
+        std::vector<K> oldKeys(capacity);
+        std::vector<V> oldValues(capacity);
+        std::vector<uint8_t> oldUsed(capacity, 0);
+        oldKeys.swap(keys);
+        oldValues.swap(values);
+        oldUsed.swap(used);
+        for (size_t i = 0; i < oldKeys.size(); ++i) {
+            if (oldUsed[i]) {
+                size_t slot = slotOf(oldKeys[i]);
+                used[slot] = 1;
+                keys[slot] = std::move(oldKeys[i]);
+                values[slot] = std::move(oldValues[i]);
+            }
+        }
+    }
+
 public:
+    explicit FlatHashMap(size_t expected = 0) {
+        reserve(expected);
+    }
+
+    // Size the table for `expected` keys at a load factor of at most 1/2
+    void reserve(size_t expected) {
+        size_t capacity = 16;
+        while (capacity < 2 * expected) {
+            capacity *= 2;
+        }
+        if (capacity > keys.size()) {
+            rehash(capacity);
+        }
+    }
+
+    size_t size() const { return count; }
+
+    // The value stored for key, inserting `value` first if the key is new.
+    // The second member is true when the key was inserted.
+    std::pair<V*, bool> findOrInsert(const K& key, const V& value) {
+        if (2 * (count + 1) > keys.size()) {
+            reserve(count + 1);
+        }
+        size_t slot = slotOf(key);
+        if (used[slot]) {
+            return std::make_pair(&values[slot], false);
+        }
+        used[slot] = 1;
+        keys[slot] = key;
+        values[slot] = value;
+        ++count;
+        return std::make_pair(&values[slot], true);
+    }
+
+    const V* find(const K& key) const {
+        size_t slot = slotOf(key);
+        return used[slot] ? &values[slot] : nullptr;
+    }
+
+    // Insert (key, value), or combine value into the value already stored for key
     template <typename Func>
-    static void executeParallel(const std::vector<Func>& tasks) {
-        std::vector<std::thread> threads;
-        for (const auto& task : tasks) {
-            threads.emplace_back(task);
+    void merge(const K& key, const V& value, Func combine) {
+        std::pair<V*, bool> entry = findOrInsert(key, value);
+        if (!entry.second) {
+            *entry.first = combine(*entry.first, value);
+        }
+    }
+
+    template <typename Func>
+    void forEach(Func func) const {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (used[i]) {
+                func(keys[i], values[i]);
+            }
+        }
+    }
+};
+
+// Map output of a shuffle. Map task m keeps its last records in memory, grouped by
+// reduce partition: blocks[m][offsets[m][r] .. offsets[m][r + 1]) go to partition r.
+// Records that did not fit in the task's memory budget were spilled before that, as
+// runs grouped by reduce partition the same way, so a reduce task reads one
+// contiguous range from each run.
+template <typename K, typename V>
+struct ShuffleOutput {
+    struct SpilledRun {
+        std::shared_ptr<SpillFile> file;
+        std::vector<size_t> byteOffsets;   // Partition r is bytes [byteOffsets[r], byteOffsets[r + 1]) of the file
+        std::vector<size_t> recordOffsets; // and records [recordOffsets[r], recordOffsets[r + 1]) of the run
+    };
+
+    std::vector<std::vector<std::pair<K, V>>> blocks;
+    std::vector<std::vector<size_t>> offsets;
+    std::vector<std::vector<SpilledRun>> runs;
+
+    // Number of records sent to reduce partition r, to size its buffers up front
+    size_t recordsFor(size_t r) const {
+        size_t total = 0;
+        for (size_t m = 0; m < blocks.size(); ++m) {
+            total += offsets[m][r + 1] - offsets[m][r];
+            for (const SpilledRun& run : runs[m]) {
+                total += run.recordOffsets[r + 1] - run.recordOffsets[r];
+            }
+        }
+        return total;
+    }
+
+    template <typename Func>
+    void forEachRecord(size_t r, Func func) const {
+        std::pair<K, V> record;
+        size_t spilled = 0;
+        for (size_t m = 0; m < blocks.size(); ++m) {
+            for (const SpilledRun& run : runs[m]) {
+                spilled += run.byteOffsets[r + 1] - run.byteOffsets[r];
+                RunReader<std::pair<K, V>> reader(run.file, run.byteOffsets[r], run.byteOffsets[r + 1]);
+                while (reader.read(record)) {
+                    func(record);
+                }
+            }
+            for (size_t i = offsets[m][r]; i < offsets[m][r + 1]; ++i) {
+                func(blocks[m][i]);
+            }
+        }
+        JobProfiler::recordInput(recordsFor(r), spilled);
+    }
+};
+
+// A shuffle and the flag that makes its map stage run only once, however many
+// actions read it
+template <typename K, typename V>
+struct ShuffleDependency {
+    std::once_flag mapped;
+    ShuffleOutput<K, V> output;
+};
+
+// Bucket one map task's records by reduce partition with a counting sort: count the
+// records of every partition, then move each record straight to its final place in a
+// block that is allocated once
+template <typename K, typename V, typename Partitioner>
+void writeShuffleBlock(std::vector<std::pair<K, V>>& records, size_t numReducers, const Partitioner& partitioner,
+                       std::vector<std::pair<K, V>>& block, std::vector<size_t>& offsets) {
+    std::vector<uint32_t> bucket(records.size());
+    offsets.assign(numReducers + 1, 0);
+    for (size_t i = 0; i < records.size(); ++i) {
+        bucket[i] = (uint32_t)partitioner(records[i].first);
+        ++offsets[bucket[i] + 1];
+    }
+    for (size_t r = 0; r < numReducers; ++r) {
+        offsets[r + 1] += offsets[r];
+    }
+    block.resize(records.size());
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < records.size(); ++i) {
+        block[next[bucket[i]]++] = std::move(records[i]);
+    }
+    records.clear();
+}
+
+// Run the map side of a shuffle: one task per parent partition computes its records
+// and buckets them by reduce partition. A task whose records outgrow its share of the
+// memory budget buckets what it has and spills it as a run to its own spill file.
+// With a combine function, values of equal keys are merged first (map-side combine).
+// `pipeline` names the stage for the JobProfiler.
+template <typename K, typename V>
+void runMapStage(const typename RDD<std::pair<K, V>>::Compute& compute, size_t maps, size_t numReducers,
+                 const std::function<V(const V&, const V&)>& combine,
+                 const std::function<size_t(const K&)>& partitioner, const std::string& pipeline,
+                 ShuffleOutput<K, V>& output) {
+    using Record = std::pair<K, V>;
+    output.blocks.resize(maps);
+    output.offsets.resize(maps);
+    output.runs.resize(maps);
+    size_t budget = ClusterManager::taskMemoryBudget();
+
+    JobProfiler::instance().runStage("shuffle map", pipeline, maps, [&](size_t m) {
+        std::vector<Record> records;
+        size_t bytes = 0, spilled = 0;
+        std::shared_ptr<SpillFile> file;
+
+        auto spill = [&]() {
+            std::vector<Record> block;
+            typename ShuffleOutput<K, V>::SpilledRun run;
+            writeShuffleBlock(records, numReducers, partitioner, block, run.recordOffsets);
+            if (!file) {
+                file = std::make_shared<SpillFile>();
+            }
+            run.file = file;
+            RunWriter<Record> writer(file);
+            run.byteOffsets.push_back(writer.position());
+            for (size_t r = 0; r < numReducers; ++r) {
+                for (size_t i = run.recordOffsets[r]; i < run.recordOffsets[r + 1]; ++i) {
+                    writer.write(block[i]);
+                }
+                run.byteOffsets.push_back(writer.position());
+            }
+            writer.flush();
+            output.runs[m].push_back(std::move(run));
+            spilled += block.size();
+            bytes = 0;
+        };
+
+        if (combine) {
+            FlatHashMap<K, V> table;
+            auto drain = [&]() {
+                table.forEach([&](const K& key, const V& value) { records.emplace_back(key, value); });
+                table = FlatHashMap<K, V>();
+            };
+            compute(m, [&](const Record& record) {
+                std::pair<V*, bool> entry = table.findOrInsert(record.first, record.second);
+                if (!entry.second) {
+                    *entry.first = combine(*entry.first, record.second);
+                } else if ((bytes += 2 * estimateSize(record)) > budget) {
+                    drain();
+                    spill();
+                }
+            });
+            drain();
+        } else {
+            compute(m, [&](const Record& record) {
+                records.push_back(record);
+                if ((bytes += estimateSize(record)) > budget) {
+                    spill();
+                }
+            });
         }
-        for (auto& thread : threads) {
-            thread.join();
+        writeShuffleBlock(records, numReducers, partitioner, output.blocks[m], output.offsets[m]);
+        size_t blockBytes = 0;
+        for (const Record& record : output.blocks[m]) {
+            blockBytes += estimateSize(record);
         }
+        JobProfiler::recordOutput(spilled + output.blocks[m].size(), blockBytes);
+    });
+}
+
+enum JoinStrategy {
+    HASH_JOIN,       // Build a hash table on the left side of each partition, probe it with the right
+    SORT_MERGE_JOIN  // Sort both sides of each partition by key and merge them (needs K < K)
+};
+
+// Key-value RDD with the operations that need a shuffle. Records with equal keys are
+// brought to the same partition by hashing the key (partitionOf); the map side of the
+// shuffle runs as its own stage, and the reduce side is fused into the tasks of the
+// next stage like any other transformation.
+template <typename K, typename V>
+class PairRDD : public RDD<std::pair<K, V>> {
+private:
+    using Base = RDD<std::pair<K, V>>;
+    using Combine = std::function<V(const V&, const V&)>;
+
+    template <typename K2, typename V2>
+    friend class PairRDD;
+
+    size_t reducers(size_t numPartitions) const {
+        return numPartitions ? numPartitions : this->numPartitions;
+    }
+
+    // The map stage of a shuffle into numReducers partitions. With a combine function
+    // each map task first merges the values of equal keys (map-side combine), so only
+    // one record per key and map task is shuffled.
+    std::function<void()> shuffleStage(std::shared_ptr<ShuffleDependency<K, V>> dependency, size_t numReducers,
+                                       Combine combine) const {
+        std::function<void()> parentStages = this->prepareStages;
+        typename Base::Compute compute = this->compute;
+        size_t maps = this->numPartitions;
+        std::string pipeline = stagePipeline(this->lineage.get()) + " -> shuffle write";
+        return [=]() {
+            if (parentStages) {
+                parentStages();
+            }
+            std::call_once(dependency->mapped, [&]() {
+                runMapStage<K, V>(compute, maps, numReducers, combine,
+                                  [numReducers](const K& key) { return partitionOf(key, numReducers); },
+                                  pipeline, dependency->output);
+            });
+        };
+    }
+
+public:
+    PairRDD(const Base& rdd) : Base(rdd) {}
+
+    PairRDD(const std::vector<std::pair<K, V>>& inputData, size_t numPartitions = 0)
+        : Base(inputData, numPartitions) {}
+
+    // Transformation: ReduceByKey (Merge the values of each key with an associative
+    // function). Values are combined on the map side before the shuffle and again on
+    // the reduce side, in a table sized from the number of records received.
+    template <typename Func>
+    PairRDD reduceByKey(Func func, size_t numPartitions = 0) const {
+        auto dependency = std::make_shared<ShuffleDependency<K, V>>();
+        size_t numReducers = reducers(numPartitions);
+        Combine combine = func;
+        typename Base::Compute compute = [dependency, combine](size_t r, const typename Base::Consumer& consumer) {
+            const ShuffleOutput<K, V>& output = dependency->output;
+            FlatHashMap<K, V> table(output.recordsFor(r));
+            output.forEachRecord(r, [&](const std::pair<K, V>& record) {
+                table.merge(record.first, record.second, combine);
+            });
+            table.forEach([&](const K& key, const V& value) { consumer(std::pair<K, V>(key, value)); });
+        };
+        return PairRDD(Base(compute, numReducers,
+                            this->derive("reduceByKey (shuffle, " + std::to_string(numReducers) + " partitions)", true),
+                            shuffleStage(dependency, numReducers, combine)));
+    }
+
+    // Transformation: GroupByKey (All the values of each key, as one vector)
+    PairRDD<K, std::vector<V>> groupByKey(size_t numPartitions = 0) const {
+        auto dependency = std::make_shared<ShuffleDependency<K, V>>();
+        size_t numReducers = reducers(numPartitions);
+        typename RDD<std::pair<K, std::vector<V>>>::Compute compute =
+            [dependency](size_t r, const typename RDD<std::pair<K, std::vector<V>>>::Consumer& consumer) {
+                const ShuffleOutput<K, V>& output = dependency->output;
+                FlatHashMap<K, size_t> groupOf(output.recordsFor(r));
+                std::vector<std::pair<K, std::vector<V>>> groups;
+                output.forEachRecord(r, [&](const std::pair<K, V>& record) {
+                    std::pair<size_t*, bool> entry = groupOf.findOrInsert(record.first, groups.size());
+                    if (entry.second) {
+                        groups.emplace_back(record.first, std::vector<V>());
+                    }
+                    groups[*entry.first].second.push_back(record.second);
+                });
+                for (const auto& group : groups) {
+                    consumer(group);
+                }
+            };
+        return PairRDD<K, std::vector<V>>(RDD<std::pair<K, std::vector<V>>>(compute, numReducers,
+            this->derive("groupByKey (shuffle, " + std::to_string(numReducers) + " partitions)", true),
+            shuffleStage(dependency, numReducers, nullptr)));
+    }
+
+    // Transformation: Join (Inner join on the key). Both sides are shuffled with the
+    // same partitioner, so each output partition only joins its own two inputs.
+    template <typename W>
+    PairRDD<K, std::pair<V, W>> join(const PairRDD<K, W>& other, JoinStrategy strategy = HASH_JOIN,
+                                     size_t numPartitions = 0) const {
+        using Out = std::pair<K, std::pair<V, W>>;
+        auto left = std::make_shared<ShuffleDependency<K, V>>();
+        auto right = std::make_shared<ShuffleDependency<K, W>>();
+        size_t numReducers = reducers(numPartitions);
+        std::function<void()> leftStage = shuffleStage(left, numReducers, nullptr);
+        std::function<void()> rightStage = other.shuffleStage(right, numReducers, nullptr);
+
+        typename RDD<Out>::Compute compute = [left, right, strategy](size_t r, const typename RDD<Out>::Consumer& consumer) {
+            std::vector<std::pair<K, V>> build;
+            build.reserve(left->output.recordsFor(r));
+            left->output.forEachRecord(r, [&](const std::pair<K, V>& record) { build.push_back(record); });
+
+            if (strategy == HASH_JOIN) {
+                // Records with equal keys are chained through `next`, newest first
+                const size_t END = (size_t)-1;
+                FlatHashMap<K, size_t> head(build.size());
+                std::vector<size_t> next(build.size(), END);
+                for (size_t i = 0; i < build.size(); ++i) {
+                    std::pair<size_t*, bool> entry = head.findOrInsert(build[i].first, i);
+                    if (!entry.second) {
+                        next[i] = *entry.first;
+                        *entry.first = i;
+                    }
+                }
+                right->output.forEachRecord(r, [&](const std::pair<K, W>& record) {
+                    const size_t* first = head.find(record.first);
+                    for (size_t i = first ? *first : END; i != END; i = next[i]) {
+                        consumer(Out(record.first, std::pair<V, W>(build[i].second, record.second)));
+                    }
+                });
+                return;
+            }
+
+            std::vector<std::pair<K, W>> probe;
+            probe.reserve(right->output.recordsFor(r));
+            right->output.forEachRecord(r, [&](const std::pair<K, W>& record) { probe.push_back(record); });
+            auto byKey = [](const auto& a, const auto& b) { return a.first < b.first; };
+            std::sort(build.begin(), build.end(), byKey);
+            std::sort(probe.begin(), probe.end(), byKey);
+            size_t i = 0, j = 0;
+            while (i < build.size() && j < probe.size()) {
+                if (build[i].first < probe[j].first) {
+                    ++i;
+                } else if (probe[j].first < build[i].first) {
+                    ++j;
+                } else {
+                    size_t iEnd = i, jEnd = j;
+                    while (iEnd < build.size() && !(build[i].first < build[iEnd].first)) ++iEnd;
+                    while (jEnd < probe.size() && !(probe[j].first < probe[jEnd].first)) ++jEnd;
+                    for (size_t a = i; a < iEnd; ++a) {
+                        for (size_t b = j; b < jEnd; ++b) {
+                            consumer(Out(build[a].first, std::pair<V, W>(build[a].second, probe[b].second)));
+                        }
+                    }
+                    i = iEnd;
+                    j = jEnd;
+                }
+            }
+        };
+        return PairRDD<K, std::pair<V, W>>(RDD<Out>(compute, numReducers,
+            this->derive(std::string(strategy == HASH_JOIN ? "hash" : "sort-merge") + " join (shuffle, "
+                         + std::to_string(numReducers) + " partitions)", true),
+            [leftStage, rightStage]() {
+                leftStage();
+                rightStage();
+            }));
     }
 };
 
+// Transformation: SortBy, as a range-partitioned shuffle. A sampling pass over the
+// parent picks numPartitions - 1 key bounds so that every reduce partition gets a
+// similar share of a contiguous key range, and partition r only holds keys that sort
+// before those of partition r + 1. Each reduce task then sorts its own range: in
+// memory while its records fit its memory budget, otherwise as sorted runs spilled to
+// disk and combined with a k-way merge (external sort). Equal keys keep no particular
+// order.
+template <typename T>
+template <typename Func>
+RDD<T> RDD<T>::sortBy(Func keyFunc, bool ascending, size_t numPartitions) const {
+    using S = std::decay_t<decltype(keyFunc(std::declval<const T&>()))>;
+    using Record = std::pair<S, T>;
+    struct SortDependency {
+        std::once_flag mapped;
+        std::vector<S> bounds;
+        ShuffleOutput<S, T> output;
+    };
+
+    auto dependency = std::make_shared<SortDependency>();
+    size_t numReducers = numPartitions ? numPartitions : this->numPartitions;
+    size_t maps = this->numPartitions;
+    Compute parent = compute;
+    typename RDD<Record>::Compute keyed = [parent, keyFunc](size_t p, const typename RDD<Record>::Consumer& consumer) {
+        parent(p, [&](const T& element) { consumer(Record(keyFunc(element), element)); });
+    };
+    auto before = [ascending](const S& a, const S& b) { return ascending ? a < b : b < a; };
+    std::function<void()> parentStages = prepareStages;
+    std::string pipeline = stagePipeline(lineage.get());
+
+    std::function<void()> stage = [=]() {
+        if (parentStages) {
+            parentStages();
+        }
+        std::call_once(dependency->mapped, [&]() {
+            // Reservoir-sample the keys of every partition. A sample stands for
+            // count / samples records of its partition, so large partitions weigh more.
+            size_t perPartition = std::max<size_t>(20, 20 * numReducers / std::max<size_t>(maps, 1));
+            std::vector<std::vector<std::pair<S, double>>> samples(maps);
+            JobProfiler::instance().runStage("sample", pipeline + " -> sample keys", maps, [&](size_t m) {
+                std::vector<std::pair<S, double>>& sample = samples[m];
+                std::mt19937_64 random(m);
+                size_t seen = 0;
+                parent(m, [&](const T& element) {
+                    if (sample.size() < perPartition) {
+                        sample.emplace_back(keyFunc(element), 0.0);
+                    } else {
+                        size_t slot = random() % (seen + 1);
+                        if (slot < perPartition) {
+                            sample[slot].first = keyFunc(element);
+                        }
+                    }
+                    ++seen;
+                });
+                for (auto& entry : sample) {
+                    entry.second = (double)seen / sample.size();
+                }
+                JobProfiler::recordOutput(sample.size());
+            });
+
+            std::vector<std::pair<S, double>> all;
+            double total = 0.0;
+            for (auto& sample : samples) {
+                for (auto& entry : sample) {
+                    total += entry.second;
+                    all.push_back(std::move(entry));
+                }
+            }
+            std::sort(all.begin(), all.end(), [&](const auto& a, const auto& b) { return before(a.first, b.first); });
+            double weight = 0.0;
+            for (size_t i = 0; i < all.size() && dependency->bounds.size() + 1 < numReducers; ++i) {
+                weight += all[i].second;
+                if (weight >= total * (dependency->bounds.size() + 1) / numReducers
+                    && (dependency->bounds.empty() || before(dependency->bounds.back(), all[i].first))) {
+                    dependency->bounds.push_back(all[i].first);
+                }
+            }
+
+            const std::vector<S>& bounds = dependency->bounds;
+            runMapStage<S, T>(keyed, maps, numReducers, nullptr, [&](const S& key) {
+                return (size_t)(std::lower_bound(bounds.begin(), bounds.end(), key, before) - bounds.begin());
+            }, pipeline + " -> key -> shuffle write", dependency->output);
+        });
+    };
+
+    Compute sorted = [dependency, before](size_t r, const Consumer& consumer) {
+        auto byKey = [&](const Record& a, const Record& b) { return before(a.first, b.first); };
+        size_t budget = ClusterManager::taskMemoryBudget();
+        std::vector<Record> records;
+        size_t bytes = 0;
+        std::shared_ptr<SpillFile> file;
+        std::vector<std::pair<size_t, size_t>> runs; // Byte range of every sorted run
+
+        dependency->output.forEachRecord(r, [&](const Record& record) {
+            records.push_back(record);
+            if ((bytes += estimateSize(record)) <= budget) {
+                return;
+            }
+            std::sort(records.begin(), records.end(), byKey);
+            if (!file) {
+                file = std::make_shared<SpillFile>();
+            }
+            RunWriter<Record> writer(file);
+            size_t begin = writer.position();
+            for (const Record& sortedRecord : records) {
+                writer.write(sortedRecord);
+            }
+            writer.flush();
+            runs.emplace_back(begin, writer.position());
+            records.clear();
+            bytes = 0;
+        });
+        std::sort(records.begin(), records.end(), byKey);
+        if (runs.empty()) {
+            for (const Record& record : records) {
+                consumer(record.second);
+            }
+            return;
+        }
+
+        // k-way merge of the spilled runs and the records still in memory (source
+        // runs.size()). The heap holds one source per run, ordered by its head record.
+        size_t memory = runs.size(), nextInMemory = 0;
+        std::vector<RunReader<Record>> readers;
+        std::vector<Record> heads(runs.size() + 1);
+        auto advance = [&](size_t source) {
+            if (source < memory) {
+                return readers[source].read(heads[source]);
+            }
+            if (nextInMemory == records.size()) {
+                return false;
+            }
+            heads[source] = std::move(records[nextInMemory++]);
+            return true;
+        };
+        auto later = [&](size_t a, size_t b) { return before(heads[b].first, heads[a].first); };
+        std::priority_queue<size_t, std::vector<size_t>, decltype(later)> heap(later);
+        for (const auto& run : runs) {
+            readers.emplace_back(file, run.first, run.second);
+        }
+        for (size_t source = 0; source <= memory; ++source) {
+            if (advance(source)) {
+                heap.push(source);
+            }
+        }
+        while (!heap.empty()) {
+            size_t source = heap.top();
+            heap.pop();
+            consumer(heads[source].second);
+            if (advance(source)) {
+                heap.push(source);
+            }
+        }
+    };
+
+    return RDD(sorted, numReducers, derive("sortBy (range shuffle, " + std::to_string(numReducers) + " partitions)", true),
+               stage);
+}
+
 int main() {
     // Sample input data
     std::vector<int> data = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
@@ -75,20 +2254,169 @@ int main() {
     // Create an RDD
     RDD<int> rdd(data);
 
-    // Perform transformations
+    // Perform transformations (nothing is computed yet)
     auto mappedRDD = rdd.map([](int x) { return x * 2; });  // Multiply each element by 2
     auto filteredRDD = mappedRDD.filter([](int x) { return x > 10; }); // Keep elements > 10
 
-    // Perform actions
+    // Perform actions: each one runs the fused map + filter in a single pass
     std::vector<int> collectedData = filteredRDD.collect(); // Collect data
     int reducedResult = filteredRDD.reduce([](int x, int y) { return x + y; }); // Sum all elements
 
     // Output results
+    std::cout << "Lineage:\n" << filteredRDD.toDebugString();
     std::cout << "Collected Data: ";
     for (const auto& val : collectedData) {
         std::cout << val << " ";
     }
     std::cout << "\nReduced Result: " << reducedResult << std::endl;
 
+    // A larger job: the same pipeline over 20 million elements on every partition,
+    // run on column batches
+    std::vector<long long> big(20000000);
+    for (size_t i = 0; i < big.size(); ++i) {
+        big[i] = (long long)i;
+    }
+    RDD<long long> bigRDD(std::move(big));
+    auto start = std::chrono::steady_clock::now();
+    long long sum = bigRDD.map([](long long x) { return x * 2; })
+                          .filter([](long long x) { return x % 3 == 0; })
+                          .reduce([](long long x, long long y) { return x + y; });
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Sum over " << bigRDD.getNumPartitions() << " partitions on " << ClusterManager::pool().size()
+              << " threads: " << sum << " (" << ms << " ms, "
+              << bigRDD.count() * sizeof(long long) / (ms * 1e6) << " GB/s)" << std::endl;
+
+    // Key-value operations: word count, grouping and a join
+    std::vector<std::string> words = {"spark", "rdd", "shuffle", "spark", "join", "rdd", "spark"};
+    PairRDD<std::string, int> ones(RDD<std::string>(words).map([](const std::string& w) { return std::make_pair(w, 1); }));
+    auto wordCounts = ones.reduceByKey([](int x, int y) { return x + y; });
+    std::vector<std::pair<std::string, int>> counted = wordCounts.collect();
+    std::sort(counted.begin(), counted.end());
+    std::cout << "\nWord counts: ";
+    for (const auto& kv : counted) {
+        std::cout << kv.first << "=" << kv.second << " ";
+    }
+
+    PairRDD<int, std::string> employees({{1, "ann"}, {2, "bob"}, {1, "cid"}, {3, "dan"}});
+    PairRDD<int, std::string> departments({{1, "sales"}, {2, "research"}, {4, "legal"}});
+    std::cout << "\nGrouped by department id: ";
+    for (const auto& group : employees.groupByKey().collect()) {
+        std::cout << group.first << ":" << group.second.size() << " ";
+    }
+    for (JoinStrategy strategy : {HASH_JOIN, SORT_MERGE_JOIN}) {
+        auto joined = employees.join(departments, strategy).collect();
+        std::sort(joined.begin(), joined.end());
+        std::cout << "\nJoined (" << (strategy == HASH_JOIN ? "hash" : "sort-merge") << "): ";
+        for (const auto& row : joined) {
+            std::cout << row.second.first << "@" << row.second.second << " ";
+        }
+    }
+    std::cout << "\n" << wordCounts.toDebugString();
+
+    // Out-of-core: with a 4 MB budget the shuffles and the sort spill to disk
+    ClusterManager::setMemoryBudget(4 << 20);
+    std::mt19937 random(42);
+    std::vector<int> unsorted(2000000);
+    for (int& x : unsorted) {
+        x = (int)(random() % 1000000);
+    }
+    start = std::chrono::steady_clock::now();
+    std::vector<int> sorted = RDD<int>(unsorted).sortBy([](int x) { return x; }, false).collect();
+    ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Sorted " << sorted.size() << " elements descending: "
+              << (std::is_sorted(sorted.rbegin(), sorted.rend()) ? "ok" : "WRONG") << " (" << ms << " ms)" << std::endl;
+
+    size_t distinct = PairRDD<int, int>(RDD<int>(unsorted).map([](int x) { return std::make_pair(x, 1); }))
+                          .reduceByKey([](int x, int y) { return x + y; })
+                          .count();
+    std::cout << "Distinct keys: " << distinct << ", spilled " << (ClusterManager::spilledBytes() >> 20) << " MB"
+              << std::endl;
+    ClusterManager::setMemoryBudget(size_t(1) << 30);
+
+    // Caching: an iterative job runs a dozen actions over the same derived RDD
+    RDD<long long> samples(std::vector<long long>(2000000, 1));
+    auto expensive = samples.map([](long long x) {
+        double y = (double)x;
+        for (int k = 0; k < 10; ++k) {
+            y = std::sqrt(y + k);
+        }
+        return y;
+    });
+    auto iterate = [](const RDD<double>& input) {
+        auto begin = std::chrono::steady_clock::now();
+        double total = 0;
+        for (int iteration = 0; iteration < 12; ++iteration) {
+            total += input.map([iteration](double y) { return y * iteration; })
+                          .reduce([](double a, double b) { return a + b; });
+        }
+        (void)total;
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    };
+    std::cout << "\n12 iterations, recomputed: " << iterate(expensive) << " ms" << std::endl;
+    const char* levelNames[] = {"MEMORY", "MEMORY_SERIALIZED", "DISK"};
+    for (StorageLevel level : {MEMORY, MEMORY_SERIALIZED, DISK}) {
+        RDD<double> persisted = expensive.persist(level);
+        std::cout << "12 iterations, persisted " << levelNames[level] << ": " << iterate(persisted) << " ms, "
+                  << (BlockManager::instance().memoryUsed() >> 10) << " KB in memory" << std::endl;
+    }
+
+    // A storage budget smaller than the RDD: the least recently used blocks are evicted
+    ClusterManager::setStorageBudget(8 << 20);
+    RDD<double> cached = expensive.cache();
+    PartitionedView<double> view = cached.collectView();
+    std::cout << "View of " << view.size() << " elements in " << view.partitions().size() << " partitions, "
+              << "first " << view[0] << "; cached " << (BlockManager::instance().memoryUsed() >> 10) << " KB, "
+              << BlockManager::instance().getEvictions() << " blocks evicted" << std::endl;
+    cached.unpersist();
+    ClusterManager::setStorageBudget(size_t(1) << 30);
+
+    // File sources: a CSV log and a file of 4-byte records, streamed partition by partition
+    const char* logPath = "spark_demo_log.csv";
+    const char* binaryPath = "spark_demo_records.bin";
+    {
+        std::FILE* log = std::fopen(logPath, "w");
+        std::FILE* binary = std::fopen(binaryPath, "wb");
+        const char* levels[] = {"INFO", "WARN", "ERROR"};
+        for (int i = 0; i < 300000; ++i) {
+            std::fprintf(log, "%d,%s,\"request %d, attempt %d\",%d\n", i, levels[i % 7 == 0 ? 2 : i % 3 == 0],
+                         i, i % 4, (i * 37) % 1000);
+            std::fwrite(&i, sizeof(i), 1, binary);
+        }
+        std::fclose(log);
+        std::fclose(binary);
+    }
+    auto lines = RDD<std::string>::textFile(logPath);
+    PairRDD<std::string, long long> latencyByLevel(lines.map([](const std::string& line) {
+        std::vector<std::string> fields = splitCsvLine(line);
+        return std::make_pair(fields[1], std::stoll(fields[3]));
+    }));
+    std::vector<std::pair<std::string, long long>> latency =
+        latencyByLevel.reduceByKey([](long long x, long long y) { return x + y; }).collect();
+    std::sort(latency.begin(), latency.end());
+    std::cout << lines.count() << " lines in " << lines.getNumPartitions() << " partitions, total latency:";
+    for (const auto& kv : latency) {
+        std::cout << " " << kv.first << "=" << kv.second;
+    }
+    long long recordSum = RDD<std::string>::binaryRecords(binaryPath, sizeof(int)).map([](const std::string& record) {
+        int value;
+        std::memcpy(&value, record.data(), sizeof(value));
+        return (long long)value;
+    }).reduce([](long long x, long long y) { return x + y; });
+    std::cout << "\nSum of binary records: " << recordSum << std::endl;
+
+    // Job metrics: a DAG report after every action while the listener is set, and the
+    // last job as JSON
+    JobProfiler::instance().setListener([](const JobMetrics& metrics) { std::cout << metrics.toReport(); });
+    PairRDD<std::string, long long>(latencyByLevel.filter([](const std::pair<std::string, long long>& kv) {
+        return kv.first != "INFO";
+    })).reduceByKey([](long long x, long long y) { return x + y; })
+       .sortBy([](const std::pair<std::string, long long>& kv) { return kv.second; })
+       .collect();
+    JobProfiler::instance().setListener(nullptr);
+    std::string json = JobProfiler::instance().lastJob().toJson();
+    std::cout << json.substr(0, 160) << "... (" << json.size() << " bytes of JSON)" << std::endl;
+    std::remove(logPath);
+    std::remove(binaryPath);
+
     return 0;
 }
@@ -1,619 +1,59 @@
 // A C++ Program to implement A* Search Algorithm
 // Source https://www.geeksforgeeks.org/a-search-algorithm/
+//
+// The grid map and the search itself live in GridPathfinding.h:
+// - GridMap: the map size is chosen at runtime and the cells are stored as a bitset.
+// - GridSearchState: g costs, parents and the closed list, reused between queries.
+//   Cells are generation-stamped so no memset is needed before the next search.
+// - aStarSearch(grid, src, dest, state, openListType): returns the path instead of printing it.
+//   The open list is an indexed 4-ary heap with decrease-key by default (IndexedHeap.h);
+//   BINARY_HEAP_OPEN_LIST and the original SET_OPEN_LIST can be selected instead.
+//
+// JumpPointSearch.h adds jumpPointSearch(jmap, src, dest, state), which returns paths of
+// the same cost as aStarSearch while only expanding jump points.
+//
+// HierarchicalPathfinding.h adds HierarchicalPathfinder (HPA*): near-optimal paths from a
+// cached abstract graph of cluster entrances, repaired locally by setBlocked.
+//
+// BatchPathfinding.h adds BatchPathSolver::solveBatch(queries), which answers many
+// queries on one shared map from a thread pool with one reusable state per thread.
+//
+// DStarLite.h adds DStarLite, which keeps its search between calls and only repairs the
+// part affected when cells are blocked or unblocked while the robot moves.
+//
+// GridHeuristics.h adds aStarSearchFixed(grid, src, dest, state, landmarks): fixed-point
+// costs with the octile heuristic, or the tighter landmark (ALT) heuristic.
+//
+// PathfindingBenchmark.cpp runs every solver on the .map / .scen benchmark format.
 #include <iostream>
 #include <vector>
-#include <queue>
-#include <unordered_map>
-#include <cmath>
-#include <stack>
-#include <cfloat>
-#include <set>
+#include <cstdio>
+#include <chrono>
+#include "GridPathfinding.h"
+#include "JumpPointSearch.h"
+#include "HierarchicalPathfinding.h"
+#include "BatchPathfinding.h"
+#include "DStarLite.h"
+#include "GridHeuristics.h"
 using namespace std;
 
-#define ROW 9
-#define COL 10
-
-// Creating a shortcut for int, int pair type
-typedef pair<int, int> Pair;
-
-// Creating a shortcut for pair<int, pair<int, int>> type
-typedef pair<double, pair<int, int> > pPair;
-
-// A structure to hold the necessary parameters
-struct cell {
-	// Row and Column index of its parent
-	// Note that 0 <= i <= ROW-1 & 0 <= j <= COL-1
-	int parent_i, parent_j;
-	// f = g + h
-	double f, g, h;
-};
-
-// A Utility Function to check whether given cell (row, col)
-// is a valid cell or not.
-bool isValid(int row, int col)
-{
-	// Returns true if row number and column number
-	// is in range
-	return (row >= 0) && (row < ROW) && (col >= 0)
-		&& (col < COL);
-}
-
-// A Utility Function to check whether the given cell is
-// blocked or not
-bool isUnBlocked(int grid[][COL], int row, int col)
-{
-	// Returns true if the cell is not blocked else false
-	if (grid[row][col] == 1)
-		return (true);
-	else
-		return (false);
-}
-
-// A Utility Function to check whether destination cell has
-// been reached or not
-bool isDestination(int row, int col, Pair dest)
-{
-	if (row == dest.first && col == dest.second)
-		return (true);
-	else
-		return (false);
-}
-
-// A Utility Function to calculate the 'h' heuristics.
-double calculateHValue(int row, int col, Pair dest)
-{
-	// Return using the distance formula
-	return ((double)sqrt(
-		(row - dest.first) * (row - dest.first)
-		+ (col - dest.second) * (col - dest.second)));
-}
-
-// A Utility Function to trace the path from the source
+// A Utility Function to print the path from the source
 // to destination
-void tracePath(cell cellDetails[][COL], Pair dest)
+void printPath(const vector<Pair>& path)
 {
 	printf("\nThe Path is ");
-	int row = dest.first;
-	int col = dest.second;
-
-	stack<Pair> Path;
-
-	while (!(cellDetails[row][col].parent_i == row
-			&& cellDetails[row][col].parent_j == col)) {
-		Path.push(make_pair(row, col));
-		int temp_row = cellDetails[row][col].parent_i;
-		int temp_col = cellDetails[row][col].parent_j;
-		row = temp_row;
-		col = temp_col;
-	}
-
-	Path.push(make_pair(row, col));
-	while (!Path.empty()) {
-		pair<int, int> p = Path.top();
-		Path.pop();
+	for (const Pair& p : path)
 		printf("-> (%d,%d) ", p.first, p.second);
-	}
-
-	return;
+	printf("\n");
 }
 
-// A Function to find the shortest path between
-// a given source cell to a destination cell according
-// to A* Search Algorithm
-void aStarSearch(int grid[][COL], Pair src, Pair dest)
+// Cost of a path of 8-connected moves
+double pathCost(const vector<Pair>& path)
 {
-	// If the source is out of range
-	if (isValid(src.first, src.second) == false) {
-		printf("Source is invalid\n");
-		return;
-	}
-
-	// If the destination is out of range
-	if (isValid(dest.first, dest.second) == false) {
-		printf("Destination is invalid\n");
-		return;
-	}
-
-	// Either the source or the destination is blocked
-	if (isUnBlocked(grid, src.first, src.second) == false
-		|| isUnBlocked(grid, dest.first, dest.second)
-			== false) {
-		printf("Source or the destination is blocked\n");
-		return;
-	}
-
-	// If the destination cell is the same as source cell
-	if (isDestination(src.first, src.second, dest)
-		== true) {
-		printf("We are already at the destination\n");
-		return;
-	}
-
-	// Create a closed list and initialise it to false which
-	// means that no cell has been included yet This closed
-	// list is implemented as a boolean 2D array
-	bool closedList[ROW][COL];
-	memset(closedList, false, sizeof(closedList));
-
-	// Declare a 2D array of structure to hold the details
-	// of that cell
-	cell cellDetails[ROW][COL];
-
-	int i, j;
-
-	for (i = 0; i < ROW; i++) {
-		for (j = 0; j < COL; j++) {
-			cellDetails[i][j].f = FLT_MAX;
-			cellDetails[i][j].g = FLT_MAX;
-			cellDetails[i][j].h = FLT_MAX;
-			cellDetails[i][j].parent_i = -1;
-			cellDetails[i][j].parent_j = -1;
-		}
-	}
-
-	// Initialising the parameters of the starting node
-	i = src.first, j = src.second;
-	cellDetails[i][j].f = 0.0;
-	cellDetails[i][j].g = 0.0;
-	cellDetails[i][j].h = 0.0;
-	cellDetails[i][j].parent_i = i;
-	cellDetails[i][j].parent_j = j;
-
-	/*
-	Create an open list having information as-
-	<f, <i, j>>
-	where f = g + h,
-	and i, j are the row and column index of that cell
-	Note that 0 <= i <= ROW-1 & 0 <= j <= COL-1
-	This open list is implemented as a set of pair of
-	pair.*/
-	set<pPair> openList;
-
-	// Put the starting cell on the open list and set its
-	// 'f' as 0
-	openList.insert(make_pair(0.0, make_pair(i, j)));
-
-	// We set this boolean value as false as initially
-	// the destination is not reached.
-	bool foundDest = false;
-
-	while (!openList.empty()) {
-		pPair p = *openList.begin();
-
-		// Remove this vertex from the open list
-		openList.erase(openList.begin());
-
-		// Add this vertex to the closed list
-		i = p.second.first;
-		j = p.second.second;
-		closedList[i][j] = true;
-
-		/*
-		Generating all the 8 successor of this cell
-
-			N.W N N.E
-			\ | /
-				\ | /
-			W----Cell----E
-				/ | \
-				/ | \
-			S.W S S.E
-
-		Cell-->Popped Cell (i, j)
-		N --> North	 (i-1, j)
-		S --> South	 (i+1, j)
-		E --> East	 (i, j+1)
-		W --> West		 (i, j-1)
-		N.E--> North-East (i-1, j+1)
-		N.W--> North-West (i-1, j-1)
-		S.E--> South-East (i+1, j+1)
-		S.W--> South-West (i+1, j-1)*/
-
-		// To store the 'g', 'h' and 'f' of the 8 successors
-		double gNew, hNew, fNew;
-
-		//----------- 1st Successor (North) ------------
-
-		// Only process this cell if this is a valid one
-		if (isValid(i - 1, j) == true) {
-			// If the destination cell is the same as the
-			// current successor
-			if (isDestination(i - 1, j, dest) == true) {
-				// Set the Parent of the destination cell
-				cellDetails[i - 1][j].parent_i = i;
-				cellDetails[i - 1][j].parent_j = j;
-				printf("The destination cell is found\n");
-				tracePath(cellDetails, dest);
-				foundDest = true;
-				return;
-			}
-			// If the successor is already on the closed
-			// list or if it is blocked, then ignore it.
-			// Else do the following
-			else if (closedList[i - 1][j] == false
-					&& isUnBlocked(grid, i - 1, j)
-							== true) {
-				gNew = cellDetails[i][j].g + 1.0;
-				hNew = calculateHValue(i - 1, j, dest);
-				fNew = gNew + hNew;
-
-				// If it isn’t on the open list, add it to
-				// the open list. Make the current square
-				// the parent of this square. Record the
-				// f, g, and h costs of the square cell
-				//			 OR
-				// If it is on the open list already, check
-				// to see if this path to that square is
-				// better, using 'f' cost as the measure.
-				if (cellDetails[i - 1][j].f == FLT_MAX
-					|| cellDetails[i - 1][j].f > fNew) {
-					openList.insert(make_pair(
-						fNew, make_pair(i - 1, j)));
-
-					// Update the details of this cell
-					cellDetails[i - 1][j].f = fNew;
-					cellDetails[i - 1][j].g = gNew;
-					cellDetails[i - 1][j].h = hNew;
-					cellDetails[i - 1][j].parent_i = i;
-					cellDetails[i - 1][j].parent_j = j;
-				}
-			}
-		}
-
-		//----------- 2nd Successor (South) ------------
-
-		// Only process this cell if this is a valid one
-		if (isValid(i + 1, j) == true) {
-			// If the destination cell is the same as the
-			// current successor
-			if (isDestination(i + 1, j, dest) == true) {
-				// Set the Parent of the destination cell
-				cellDetails[i + 1][j].parent_i = i;
-				cellDetails[i + 1][j].parent_j = j;
-				printf("The destination cell is found\n");
-				tracePath(cellDetails, dest);
-				foundDest = true;
-				return;
-			}
-			// If the successor is already on the closed
-			// list or if it is blocked, then ignore it.
-			// Else do the following
-			else if (closedList[i + 1][j] == false
-					&& isUnBlocked(grid, i + 1, j)
-							== true) {
-				gNew = cellDetails[i][j].g + 1.0;
-				hNew = calculateHValue(i + 1, j, dest);
-				fNew = gNew + hNew;
-
-				// If it isn’t on the open list, add it to
-				// the open list. Make the current square
-				// the parent of this square. Record the
-				// f, g, and h costs of the square cell
-				//			 OR
-				// If it is on the open list already, check
-				// to see if this path to that square is
-				// better, using 'f' cost as the measure.
-				if (cellDetails[i + 1][j].f == FLT_MAX
-					|| cellDetails[i + 1][j].f > fNew) {
-					openList.insert(make_pair(
-						fNew, make_pair(i + 1, j)));
-					// Update the details of this cell
-					cellDetails[i + 1][j].f = fNew;
-					cellDetails[i + 1][j].g = gNew;
-					cellDetails[i + 1][j].h = hNew;
-					cellDetails[i + 1][j].parent_i = i;
-					cellDetails[i + 1][j].parent_j = j;
-				}
-			}
-		}
-
-		//----------- 3rd Successor (East) ------------
-
-		// Only process this cell if this is a valid one
-		if (isValid(i, j + 1) == true) {
-			// If the destination cell is the same as the
-			// current successor
-			if (isDestination(i, j + 1, dest) == true) {
-				// Set the Parent of the destination cell
-				cellDetails[i][j + 1].parent_i = i;
-				cellDetails[i][j + 1].parent_j = j;
-				printf("The destination cell is found\n");
-				tracePath(cellDetails, dest);
-				foundDest = true;
-				return;
-			}
-
-			// If the successor is already on the closed
-			// list or if it is blocked, then ignore it.
-			// Else do the following
-			else if (closedList[i][j + 1] == false
-					&& isUnBlocked(grid, i, j + 1)
-							== true) {
-				gNew = cellDetails[i][j].g + 1.0;
-				hNew = calculateHValue(i, j + 1, dest);
-				fNew = gNew + hNew;
-
-				// If it isn’t on the open list, add it to
-				// the open list. Make the current square
-				// the parent of this square. Record the
-				// f, g, and h costs of the square cell
-				//			 OR
-				// If it is on the open list already, check
-				// to see if this path to that square is
-				// better, using 'f' cost as the measure.
-				if (cellDetails[i][j + 1].f == FLT_MAX
-					|| cellDetails[i][j + 1].f > fNew) {
-					openList.insert(make_pair(
-						fNew, make_pair(i, j + 1)));
-
-					// Update the details of this cell
-					cellDetails[i][j + 1].f = fNew;
-					cellDetails[i][j + 1].g = gNew;
-					cellDetails[i][j + 1].h = hNew;
-					cellDetails[i][j + 1].parent_i = i;
-					cellDetails[i][j + 1].parent_j = j;
-				}
-			}
-		}
-
-		//----------- 4th Successor (West) ------------
-
-		// Only process this cell if this is a valid one
-		if (isValid(i, j - 1) == true) {
-			// If the destination cell is the same as the
-			// current successor
-			if (isDestination(i, j - 1, dest) == true) {
-				// Set the Parent of the destination cell
-				cellDetails[i][j - 1].parent_i = i;
-				cellDetails[i][j - 1].parent_j = j;
-				printf("The destination cell is found\n");
-				tracePath(cellDetails, dest);
-				foundDest = true;
-				return;
-			}
-
-			// If the successor is already on the closed
-			// list or if it is blocked, then ignore it.
-			// Else do the following
-			else if (closedList[i][j - 1] == false
-					&& isUnBlocked(grid, i, j - 1)
-							== true) {
-				gNew = cellDetails[i][j].g + 1.0;
-				hNew = calculateHValue(i, j - 1, dest);
-				fNew = gNew + hNew;
-
-				// If it isn’t on the open list, add it to
-				// the open list. Make the current square
-				// the parent of this square. Record the
-				// f, g, and h costs of the square cell
-				//			 OR
-				// If it is on the open list already, check
-				// to see if this path to that square is
-				// better, using 'f' cost as the measure.
-				if (cellDetails[i][j - 1].f == FLT_MAX
-					|| cellDetails[i][j - 1].f > fNew) {
-					openList.insert(make_pair(
-						fNew, make_pair(i, j - 1)));
-
-					// Update the details of this cell
-					cellDetails[i][j - 1].f = fNew;
-					cellDetails[i][j - 1].g = gNew;
-					cellDetails[i][j - 1].h = hNew;
-					cellDetails[i][j - 1].parent_i = i;
-					cellDetails[i][j - 1].parent_j = j;
-				}
-			}
-		}
-
-		//----------- 5th Successor (North-East)
-		//------------
-
-		// Only process this cell if this is a valid one
-		if (isValid(i - 1, j + 1) == true) {
-			// If the destination cell is the same as the
-			// current successor
-			if (isDestination(i - 1, j + 1, dest) == true) {
-				// Set the Parent of the destination cell
-				cellDetails[i - 1][j + 1].parent_i = i;
-				cellDetails[i - 1][j + 1].parent_j = j;
-				printf("The destination cell is found\n");
-				tracePath(cellDetails, dest);
-				foundDest = true;
-				return;
-			}
-
-			// If the successor is already on the closed
-			// list or if it is blocked, then ignore it.
-			// Else do the following
-			else if (closedList[i - 1][j + 1] == false
-					&& isUnBlocked(grid, i - 1, j + 1)
-							== true) {
-				gNew = cellDetails[i][j].g + 1.414;
-				hNew = calculateHValue(i - 1, j + 1, dest);
-				fNew = gNew + hNew;
-
-				// If it isn’t on the open list, add it to
-				// the open list. Make the current square
-				// the parent of this square. Record the
-				// f, g, and h costs of the square cell
-				//			 OR
-				// If it is on the open list already, check
-				// to see if this path to that square is
-				// better, using 'f' cost as the measure.
-				if (cellDetails[i - 1][j + 1].f == FLT_MAX
-					|| cellDetails[i - 1][j + 1].f > fNew) {
-					openList.insert(make_pair(
-						fNew, make_pair(i - 1, j + 1)));
-
-					// Update the details of this cell
-					cellDetails[i - 1][j + 1].f = fNew;
-					cellDetails[i - 1][j + 1].g = gNew;
-					cellDetails[i - 1][j + 1].h = hNew;
-					cellDetails[i - 1][j + 1].parent_i = i;
-					cellDetails[i - 1][j + 1].parent_j = j;
-				}
-			}
-		}
-
-		//----------- 6th Successor (North-West)
-		//------------
-
-		// Only process this cell if this is a valid one
-		if (isValid(i - 1, j - 1) == true) {
-			// If the destination cell is the same as the
-			// current successor
-			if (isDestination(i - 1, j - 1, dest) == true) {
-				// Set the Parent of the destination cell
-				cellDetails[i - 1][j - 1].parent_i = i;
-				cellDetails[i - 1][j - 1].parent_j = j;
-				printf("The destination cell is found\n");
-				tracePath(cellDetails, dest);
-				foundDest = true;
-				return;
-			}
-
-			// If the successor is already on the closed
-			// list or if it is blocked, then ignore it.
-			// Else do the following
-			else if (closedList[i - 1][j - 1] == false
-					&& isUnBlocked(grid, i - 1, j - 1)
-							== true) {
-				gNew = cellDetails[i][j].g + 1.414;
-				hNew = calculateHValue(i - 1, j - 1, dest);
-				fNew = gNew + hNew;
-
-				// If it isn’t on the open list, add it to
-				// the open list. Make the current square
-				// the parent of this square. Record the
-				// f, g, and h costs of the square cell
-				//			 OR
-				// If it is on the open list already, check
-				// to see if this path to that square is
-				// better, using 'f' cost as the measure.
-				if (cellDetails[i - 1][j - 1].f == FLT_MAX
-					|| cellDetails[i - 1][j - 1].f > fNew) {
-					openList.insert(make_pair(
-						fNew, make_pair(i - 1, j - 1)));
-					// Update the details of this cell
-					cellDetails[i - 1][j - 1].f = fNew;
-					cellDetails[i - 1][j - 1].g = gNew;
-					cellDetails[i - 1][j - 1].h = hNew;
-					cellDetails[i - 1][j - 1].parent_i = i;
-					cellDetails[i - 1][j - 1].parent_j = j;
-				}
-			}
-		}
-
-		//----------- 7th Successor (South-East)
-		//------------
-
-		// Only process this cell if this is a valid one
-		if (isValid(i + 1, j + 1) == true) {
-			// If the destination cell is the same as the
-			// current successor
-			if (isDestination(i + 1, j + 1, dest) == true) {
-				// Set the Parent of the destination cell
-				cellDetails[i + 1][j + 1].parent_i = i;
-				cellDetails[i + 1][j + 1].parent_j = j;
-				printf("The destination cell is found\n");
-				tracePath(cellDetails, dest);
-				foundDest = true;
-				return;
-			}
-
-			// If the successor is already on the closed
-			// list or if it is blocked, then ignore it.
-			// Else do the following
-			else if (closedList[i + 1][j + 1] == false
-					&& isUnBlocked(grid, i + 1, j + 1)
-							== true) {
-				gNew = cellDetails[i][j].g + 1.414;
-				hNew = calculateHValue(i + 1, j + 1, dest);
-				fNew = gNew + hNew;
-
-				// If it isn’t on the open list, add it to
-				// the open list. Make the current square
-				// the parent of this square. Record the
-				// f, g, and h costs of the square cell
-				//			 OR
-				// If it is on the open list already, check
-				// to see if this path to that square is
-				// better, using 'f' cost as the measure.
-				if (cellDetails[i + 1][j + 1].f == FLT_MAX
-					|| cellDetails[i + 1][j + 1].f > fNew) {
-					openList.insert(make_pair(
-						fNew, make_pair(i + 1, j + 1)));
-
-					// Update the details of this cell
-					cellDetails[i + 1][j + 1].f = fNew;
-					cellDetails[i + 1][j + 1].g = gNew;
-					cellDetails[i + 1][j + 1].h = hNew;
-					cellDetails[i + 1][j + 1].parent_i = i;
-					cellDetails[i + 1][j + 1].parent_j = j;
-				}
-			}
-		}
-
-		//----------- 8th Successor (South-West)
-		//------------
-
-		// Only process this cell if this is a valid one
-		if (isValid(i + 1, j - 1) == true) {
-			// If the destination cell is the same as the
-			// current successor
-			if (isDestination(i + 1, j - 1, dest) == true) {
-				// Set the Parent of the destination cell
-				cellDetails[i + 1][j - 1].parent_i = i;
-				cellDetails[i + 1][j - 1].parent_j = j;
-				printf("The destination cell is found\n");
-				tracePath(cellDetails, dest);
-				foundDest = true;
-				return;
-			}
-
-			// If the successor is already on the closed
-			// list or if it is blocked, then ignore it.
-			// Else do the following
-			else if (closedList[i + 1][j - 1] == false
-					&& isUnBlocked(grid, i + 1, j - 1)
-							== true) {
-				gNew = cellDetails[i][j].g + 1.414;
-				hNew = calculateHValue(i + 1, j - 1, dest);
-				fNew = gNew + hNew;
-
-				// If it isn’t on the open list, add it to
-				// the open list. Make the current square
-				// the parent of this square. Record the
-				// f, g, and h costs of the square cell
-				//			 OR
-				// If it is on the open list already, check
-				// to see if this path to that square is
-				// better, using 'f' cost as the measure.
-				if (cellDetails[i + 1][j - 1].f == FLT_MAX
-					|| cellDetails[i + 1][j - 1].f > fNew) {
-					openList.insert(make_pair(
-						fNew, make_pair(i + 1, j - 1)));
-
-					// Update the details of this cell
-					cellDetails[i + 1][j - 1].f = fNew;
-					cellDetails[i + 1][j - 1].g = gNew;
-					cellDetails[i + 1][j - 1].h = hNew;
-					cellDetails[i + 1][j - 1].parent_i = i;
-					cellDetails[i + 1][j - 1].parent_j = j;
-				}
-			}
-		}
-	}
-
-	// When the destination cell is not found and the open
-	// list is empty, then we conclude that we failed to
-	// reach the destination cell. This may happen when the
-	// there is no way to destination cell (due to
-	// blockages)
-	if (foundDest == false)
-		printf("Failed to find the Destination Cell\n");
-
-	return;
+	double cost = 0.0;
+	for (size_t k = 1; k < path.size(); k++)
+		cost += (path[k].first != path[k - 1].first && path[k].second != path[k - 1].second) ? DIAGONAL_COST : 1.0;
+	return cost;
 }
 
 // Driver program to test above function
@@ -622,7 +62,7 @@ int main()
 	/* Description of the Grid-
 	1--> The cell is not blocked
 	0--> The cell is blocked */
-	int grid[ROW][COL]
+	int cells[9][10]
 		= { { 1, 0, 1, 1, 1, 1, 0, 1, 1, 1 },
 			{ 1, 1, 1, 0, 1, 1, 1, 0, 1, 1 },
 			{ 1, 1, 1, 0, 1, 1, 0, 1, 0, 1 },
@@ -632,6 +72,7 @@ int main()
 			{ 1, 0, 0, 0, 0, 1, 0, 0, 0, 1 },
 			{ 1, 0, 1, 1, 1, 1, 0, 1, 1, 1 },
 			{ 1, 1, 1, 0, 0, 0, 1, 0, 0, 1 } };
+	GridMap grid(9, 10, &cells[0][0]);
 
 	// Source is the left-most bottom-most corner
 	Pair src = make_pair(8, 0);
@@ -639,7 +80,107 @@ int main()
 	// Destination is the left-most top-most corner
 	Pair dest = make_pair(0, 0);
 
-	aStarSearch(grid, src, dest);
+	// The state can be reused by any number of searches on this map
+	GridSearchState state;
+	vector<Pair> path = aStarSearch(grid, src, dest, state);
+	if (path.empty()) {
+		printf("Failed to find the Destination Cell\n");
+	}
+	else {
+		printf("The destination cell is found\n");
+		printPath(path);
+	}
+
+	// The same query with each open list; all of them return an optimal path
+	const char* names[3] = { "std::set", "binary heap", "4-ary heap" };
+	OpenListType types[3] = { SET_OPEN_LIST, BINARY_HEAP_OPEN_LIST, QUAD_HEAP_OPEN_LIST };
+	for (int k = 0; k < 3; k++)
+		printf("%-12s open list: %zu cells on the path\n", names[k], aStarSearch(grid, src, dest, state, types[k]).size());
+
+	// Another query on the same state: blocked destination
+	path = aStarSearch(grid, src, make_pair(0, 1), state);
+	if (path.empty())
+		printf("No path to (0,1): the destination is blocked\n");
+
+	// Jump Point Search on the same grid
+	JumpPointMap jmap(grid);
+	path = jumpPointSearch(jmap, src, dest, state);
+	printf("\nJump Point Search:");
+	printPath(path);
+
+	// A warehouse-like map: shelves 2 cells wide with aisles between them
+	GridMap warehouse(1000, 1000);
+	for (int i = 10; i < 990; i++)
+		for (int j = 10; j < 990; j++)
+			if (j % 6 < 2 && i % 100 != 0)
+				warehouse.setBlocked(i, j, true);
+	JumpPointMap warehouseJmap(warehouse);
+	Pair from = make_pair(0, 0), to = make_pair(999, 997);
+	double aStarCost = pathCost(aStarSearch(warehouse, from, to, state));
+	size_t aStarExpanded = state.getExpanded();
+	double jpsCost = pathCost(jumpPointSearch(warehouseJmap, from, to, state));
+	printf("1000x1000 warehouse: A* cost %.3f, %zu cells expanded; JPS cost %.3f, %zu cells expanded\n",
+		aStarCost, aStarExpanded, jpsCost, state.getExpanded());
+
+	// HPA* on the same warehouse, before and after a wall is built across the aisles at row 550.
+	// The wall goes into a copy of the map, so the demos below still see the original.
+	GridMap walledWarehouse = warehouse;
+	HierarchicalPathfinder hpa(walledWarehouse, 32);
+	double hpaCost = pathCost(hpa.findPath(from, to));
+	printf("HPA*: %zu abstract nodes, cost %.3f, %zu abstract nodes expanded\n",
+		hpa.getNodeCount(), hpaCost, hpa.getExpanded());
+	for (int j = 10; j < 1000; j++)
+		hpa.setBlocked(550, j, true);
+	printf("HPA* after walling off row 550: cost %.3f\n", pathCost(hpa.findPath(from, to)));
+
+	// A planning cycle of short queries between the aisles, solved in parallel
+	vector<PathQuery> queries;
+	for (int k = 0; k < 1000; k++) {
+		int row = 20 + (k * 7) % 500, col = 4 + 6 * (k % 160);
+		queries.push_back(PathQuery{ make_pair(row, col), make_pair(row + 20, col + 30) });
+	}
+	BatchPathSolver solver(warehouse);
+	vector<vector<Pair>> paths = solver.solveBatch(queries);
+	size_t found = 0;
+	for (const vector<Pair>& p : paths)
+		found += !p.empty();
+	printf("Batch of %zu queries on %zu threads: %zu paths found\n", queries.size(), solver.getThreadCount(), found);
+
+	// Benchmark of the heuristics on long warehouse queries: cells expanded and time
+	vector<PathQuery> longQueries;
+	for (int k = 0; k < 20; k++)
+		longQueries.push_back(PathQuery{ make_pair(995, 4 + 48 * k), make_pair((k * 97) % 1000, 999 - 48 * k) });
+	LandmarkHeuristic landmarks(warehouse, 8);
+	FixedSearchState fixedState;
+	const char* heuristicNames[3] = { "Euclidean (double)", "octile (fixed-point)", "8 landmarks (ALT)" };
+	for (int h = 0; h < 3; h++) {
+		size_t expanded = 0;
+		double cost = 0.0;
+		auto begin = chrono::steady_clock::now();
+		for (const PathQuery& q : longQueries) {
+			if (h == 0) {
+				cost += pathCost(aStarSearch(warehouse, q.src, q.dest, state));
+				expanded += state.getExpanded();
+			}
+			else {
+				cost += pathCost(aStarSearchFixed(warehouse, q.src, q.dest, fixedState, h == 2 ? &landmarks : nullptr));
+				expanded += fixedState.getExpanded();
+			}
+		}
+		double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+		printf("%-22s total cost %.3f, %9zu cells expanded, %7.1f ms\n", heuristicNames[h], cost, expanded, ms);
+	}
+
+	// A robot crossing the warehouse finds a pallet dropped in front of it
+	DStarLite robot(warehouse, from, to);
+	path = robot.findPath();
+	size_t initialExpanded = robot.getExpanded();
+	robot.moveStart(path[100]);
+	robot.setBlocked(path[101].first, path[101].second, true);
+	double replanCost = pathCost(robot.findPath());
+	double freshCost = pathCost(aStarSearch(warehouse, path[100], to, state));
+	printf("D* Lite: %zu cells expanded initially, %zu to replan (cost %.3f); A* from scratch: %zu (cost %.3f)\n",
+		initialExpanded, robot.getExpanded() - initialExpanded, replanCost, state.getExpanded(), freshCost);
 
 	return (0);
 }
@@ -0,0 +1,158 @@
+// BatchPathfinding.h
+// Runs many independent A* queries over one shared GridMap on a thread pool
+
+#ifndef BATCHPATHFINDING_H
+#define BATCHPATHFINDING_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "GridPathfinding.h"
+
+/*
+* BatchPathSolver answers a batch of (src, dest) queries concurrently.
+*
+* - The GridMap is shared read-only by every worker; nothing is copied per query.
+* - Each worker owns one GridSearchState (g costs, parents, open list storage).
+*   The state is generation-stamped, so a worker reuses it for every query it takes
+*   without clearing or reallocating anything after the first one.
+* - Workers are started once by the constructor and sleep between batches. Queries are
+*   handed out in small chunks from an atomic counter, so a worker that drew short
+*   queries simply takes more of them.
+* - The calling thread works on the batch too, so threads = 1 runs everything inline.
+*
+* The map must not change while solveBatch is running.
+*/
+
+struct PathQuery {
+	Pair src;
+	Pair dest;
+};
+
+class BatchPathSolver {
+private:
+	// Queries taken from the counter at a time. Small enough to balance well, large
+	// enough that workers do not fight over the counter for trivial queries.
+	static const size_t CHUNK = 8;
+
+	const GridMap& grid;
+	OpenListType openListType;
+	std::vector<GridSearchState> states; // One per worker, states[0] is the calling thread's
+	std::vector<std::thread> workers;
+
+	std::mutex mutex;
+	std::condition_variable wake;     // A new batch is ready, or the solver is shutting down
+	std::condition_variable finished; // The last worker has left the current batch
+	uint64_t batch = 0;
+	size_t busy = 0;
+	bool stopping = false;
+
+	// The batch being solved
+	const std::vector<PathQuery>* queries = nullptr;
+	std::vector<std::vector<Pair>>* results = nullptr;
+	std::atomic<size_t> next{ 0 };
+
+	void work(GridSearchState& state)
+	{
+		size_t n = queries->size();
+		for (size_t begin; (begin = next.fetch_add(CHUNK, std::memory_order_relaxed)) < n;) {
+			size_t end = begin + CHUNK < n ? begin + CHUNK : n;
+			for (size_t q = begin; q < end; q++)
+				(*results)[q] = aStarSearch(grid, (*queries)[q].src, (*queries)[q].dest, state, openListType);
+		}
+	}
+
+	void workerLoop(size_t id)
+	{
+		uint64_t seen = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock, [&] { return stopping || batch != seen; });
+			if (stopping)
+				return;
+			seen = batch;
+			lock.unlock();
+			work(states[id]);
+			lock.lock();
+			if (--busy == 0)
+				finished.notify_one();
+		}
+	}
+
+public:
+	// threads = 0 uses one thread per hardware thread
+	explicit BatchPathSolver(const GridMap& grid, unsigned threads = 0,
+		OpenListType openListType = QUAD_HEAP_OPEN_LIST)
+		: grid(grid), openListType(openListType)
+	{
+		if (threads == 0)
+			threads = std::thread::hardware_concurrency();
+		if (threads == 0)
+			threads = 1;
+		states.resize(threads);
+		for (size_t id = 1; id < threads; id++)
+			workers.emplace_back(&BatchPathSolver::workerLoop, this, id);
+	}
+
+	~BatchPathSolver()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (std::thread& t : workers)
+			t.join();
+	}
+
+	BatchPathSolver(const BatchPathSolver&) = delete;
+	BatchPathSolver& operator=(const BatchPathSolver&) = delete;
+
+	size_t getThreadCount() const { return states.size(); }
+
+	// Solve every query. results[k] is the path for queries[k], with the same
+	// contract as aStarSearch (empty when there is no path).
+	std::vector<std::vector<Pair>> solveBatch(const std::vector<PathQuery>& batchQueries)
+	{
+		std::vector<std::vector<Pair>> batchResults(batchQueries.size());
+		if (batchQueries.empty())
+			return batchResults;
+
+		queries = &batchQueries;
+		results = &batchResults;
+		next.store(0, std::memory_order_relaxed);
+
+		// Only wake the workers when there is more than one chunk to share
+		bool parallel = !workers.empty() && batchQueries.size() > CHUNK;
+		if (parallel) {
+			std::lock_guard<std::mutex> lock(mutex);
+			busy = workers.size();
+			batch++;
+		}
+		if (parallel)
+			wake.notify_all();
+
+		work(states[0]);
+
+		if (parallel) {
+			std::unique_lock<std::mutex> lock(mutex);
+			finished.wait(lock, [&] { return busy == 0; });
+		}
+		queries = nullptr;
+		results = nullptr;
+		return batchResults;
+	}
+};
+
+// Convenience function for a single batch. Keep a BatchPathSolver around instead
+// when batches are solved repeatedly, so the threads and scratch are reused.
+inline std::vector<std::vector<Pair>> solveBatch(const GridMap& grid, const std::vector<PathQuery>& queries,
+	unsigned threads = 0)
+{
+	BatchPathSolver solver(grid, threads);
+	return solver.solveBatch(queries);
+}
+
+#endif
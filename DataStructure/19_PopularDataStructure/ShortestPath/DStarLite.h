@@ -0,0 +1,255 @@
+// DStarLite.h
+// D* Lite (Koenig & Likhachev): incremental replanning on a GridMap whose cells change
+
+#ifndef DSTARLITE_H
+#define DSTARLITE_H
+
+#include <vector>
+#include <set>
+#include <cstdint>
+#include <limits>
+#include "GridPathfinding.h"
+
+/*
+* D* Lite searches backwards, from the goal towards the robot, and keeps that search
+* between calls. When cells flip between blocked and unblocked, only the cells whose
+* cost-to-goal actually changes are expanded again; the rest of the search is reused.
+*
+* - g[s]:   cost-to-goal of s as of its last expansion.
+* - rhs[s]: one-step lookahead, min over the neighbours s' of cost(s, s') + g[s'].
+*   A cell is consistent when g == rhs; only inconsistent cells are queued.
+* - Keys are [min(g, rhs) + h(start, s) + km, min(g, rhs)], compared lexicographically.
+*   h is calculateHValue measured from the robot, so when the robot moves the old keys
+*   stay valid lower bounds once km is raised by the distance moved, and the queue does
+*   not need to be reordered.
+*
+* Typical use: findPath(), follow the path with moveStart() and call setBlocked() for
+* every cell the robot senses has changed, then findPath() again.
+*
+* Moves and costs are the same as aStarSearch (8-connected, diagonal corner-cutting
+* allowed), so the path costs returned are the same as aStarSearch on the current map.
+*/
+
+class DStarLite {
+private:
+	typedef std::pair<double, double> Key;
+
+	static constexpr double KEY_SLACK = 1e-9;
+
+	GridMap& grid;
+	Pair start, goal;
+	double km = 0.0; // Total heuristic distance the robot has moved
+
+	size_t expanded = 0;
+
+	std::vector<double> g, rhs;
+	std::vector<Key> queuedKey; // Key of each queued cell, so it can be found in the set
+	std::vector<uint8_t> queued;
+	std::set<std::pair<Key, uint32_t>> openList;
+
+	static double infinity() { return std::numeric_limits<double>::infinity(); }
+
+	double heuristic(size_t cell) const
+	{
+		return calculateHValue(grid.rowOf(cell), grid.colOf(cell), start);
+	}
+
+	bool isFree(int row, int col) const
+	{
+		return grid.isValid(row, col) && grid.isUnBlocked(row, col);
+	}
+
+	Key calculateKey(size_t cell) const
+	{
+		double m = std::min(g[cell], rhs[cell]);
+		return Key(m + heuristic(cell) + km, m);
+	}
+
+	void insert(size_t cell, const Key& key)
+	{
+		queuedKey[cell] = key;
+		queued[cell] = 1;
+		openList.insert(std::make_pair(key, (uint32_t)cell));
+	}
+
+	void remove(size_t cell)
+	{
+		openList.erase(std::make_pair(queuedKey[cell], (uint32_t)cell));
+		queued[cell] = 0;
+	}
+
+	// Lookahead cost of a cell: the cheapest way to the goal through one of its
+	// neighbours. Blocked cells have no moves at all.
+	double lookahead(int i, int j) const
+	{
+		if (!grid.isUnBlocked(i, j))
+			return infinity();
+		double best = infinity();
+		for (uint8_t d = 0; d < 8; d++) {
+			int row = i + DIR_ROW[d];
+			int col = j + DIR_COL[d];
+			if (isFree(row, col))
+				best = std::min(best, DIR_COST[d] + g[grid.index(row, col)]);
+		}
+		return best;
+	}
+
+	// Requeue, queue or dequeue a cell according to whether it is consistent
+	void updateVertex(size_t cell)
+	{
+		bool consistent = g[cell] == rhs[cell];
+		if (queued[cell])
+			remove(cell);
+		if (!consistent)
+			insert(cell, calculateKey(cell));
+	}
+
+	// Recompute rhs of a cell from its neighbours (except for the goal) and requeue it
+	void refresh(int row, int col)
+	{
+		size_t cell = grid.index(row, col);
+		if (row != goal.first || col != goal.second)
+			rhs[cell] = lookahead(row, col);
+		updateVertex(cell);
+	}
+
+	void computeShortestPath()
+	{
+		size_t s = grid.index(start.first, start.second);
+
+		// Cells whose key ties with the start are expanded as well (the paper stops at
+		// strictly smaller keys). findPath walks the g costs of the cells after the
+		// start too, and on a straight run where h is exact an underconsistent cell on
+		// the path ties with the start and would otherwise keep a stale g. The small
+		// slack absorbs rounding between summed step costs and the sqrt in h.
+		while (!openList.empty()
+			&& (openList.begin()->first.first <= calculateKey(s).first + KEY_SLACK || rhs[s] > g[s])) {
+			Key oldKey = openList.begin()->first;
+			uint32_t u = openList.begin()->second;
+			Key newKey = calculateKey(u);
+			int i = grid.rowOf(u);
+			int j = grid.colOf(u);
+
+			if (oldKey < newKey) {
+				// The key is out of date because the robot has moved
+				remove(u);
+				insert(u, newKey);
+			}
+			else if (g[u] > rhs[u]) {
+				// Overconsistent: the cell got cheaper, lower it and tell its neighbours
+				g[u] = rhs[u];
+				remove(u);
+				expanded++;
+				for (uint8_t d = 0; d < 8; d++) {
+					int row = i + DIR_ROW[d];
+					int col = j + DIR_COL[d];
+					if (!isFree(row, col) || (row == goal.first && col == goal.second))
+						continue;
+					size_t next = grid.index(row, col);
+					if (DIR_COST[d] + g[u] < rhs[next]) {
+						rhs[next] = DIR_COST[d] + g[u];
+						updateVertex(next);
+					}
+				}
+			}
+			else {
+				// Underconsistent: the cell got more expensive. Invalidate it and every
+				// neighbour whose lookahead went through it.
+				double oldG = g[u];
+				g[u] = infinity();
+				expanded++;
+				for (uint8_t d = 0; d < 8; d++) {
+					int row = i + DIR_ROW[d];
+					int col = j + DIR_COL[d];
+					if (!isFree(row, col))
+						continue;
+					if (rhs[grid.index(row, col)] == DIR_COST[d] + oldG)
+						refresh(row, col);
+				}
+				refresh(i, j);
+			}
+		}
+	}
+
+public:
+	// The planner changes the map through setBlocked, so it takes it by reference
+	DStarLite(GridMap& grid, Pair start, Pair goal)
+		: grid(grid), start(start), goal(goal),
+		  g(grid.size(), infinity()), rhs(grid.size(), infinity()),
+		  queuedKey(grid.size()), queued(grid.size(), 0)
+	{
+		size_t target = grid.index(goal.first, goal.second);
+		rhs[target] = 0.0;
+		insert(target, calculateKey(target));
+	}
+
+	Pair getStart() const { return start; }
+	Pair getGoal() const { return goal; }
+
+	// Number of cells expanded since the planner was created
+	size_t getExpanded() const { return expanded; }
+
+	// The robot has moved to a new cell. Nothing is searched until the next findPath.
+	void moveStart(Pair newStart)
+	{
+		// Queued keys were computed from the old start; raising km by the distance
+		// moved keeps them lower bounds for the new one
+		km += calculateHValue(start.first, start.second, newStart);
+		start = newStart;
+	}
+
+	// Block or unblock a cell and mark the cells whose lookahead depends on it.
+	// Nothing is searched until the next findPath.
+	void setBlocked(int row, int col, bool blocked)
+	{
+		if (grid.isUnBlocked(row, col) == !blocked)
+			return;
+
+		grid.setBlocked(row, col, blocked);
+		refresh(row, col);
+		for (uint8_t d = 0; d < 8; d++)
+			if (grid.isValid(row + DIR_ROW[d], col + DIR_COL[d]))
+				refresh(row + DIR_ROW[d], col + DIR_COL[d]);
+	}
+
+	// Bring the search up to date and return the path from the current start to the
+	// goal, inclusive, or an empty vector when the goal cannot be reached.
+	std::vector<Pair> findPath()
+	{
+		if (!isFree(start.first, start.second) || !isFree(goal.first, goal.second))
+			return std::vector<Pair>();
+		computeShortestPath();
+
+		// The search may stop before the start itself is expanded: its rhs is already
+		// exact, and the walk below only needs the g costs of its neighbours
+		if (rhs[grid.index(start.first, start.second)] == infinity())
+			return std::vector<Pair>();
+
+		// Walk downhill: from each cell take the move that minimises cost + g
+		std::vector<Pair> path(1, start);
+		Pair cell = start;
+		while (cell != goal) {
+			double best = infinity();
+			Pair next = cell;
+			for (uint8_t d = 0; d < 8; d++) {
+				int row = cell.first + DIR_ROW[d];
+				int col = cell.second + DIR_COL[d];
+				if (!isFree(row, col))
+					continue;
+				double cost = DIR_COST[d] + g[grid.index(row, col)];
+				if (cost < best) {
+					best = cost;
+					next = Pair(row, col);
+				}
+			}
+			// Cannot happen once the search is consistent; guards against a cycle
+			if (best == infinity() || path.size() > grid.size())
+				return std::vector<Pair>();
+			cell = next;
+			path.push_back(cell);
+		}
+		return path;
+	}
+};
+
+#endif
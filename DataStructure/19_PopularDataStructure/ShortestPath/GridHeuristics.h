@@ -0,0 +1,326 @@
+// GridHeuristics.h
+// Fixed-point octile costs and landmark (ALT) heuristics for A* on a GridMap
+
+#ifndef GRIDHEURISTICS_H
+#define GRIDHEURISTICS_H
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include <cstdlib>
+#include "GridPathfinding.h"
+
+/*
+* aStarSearch keeps g as a double and calls sqrt for the Euclidean h of every generated
+* cell. The Euclidean distance also underestimates 8-connected costs even on open ground
+* (100 right and 50 down costs 120.7, h says 111.8), and knows nothing about obstacles.
+*
+* - Fixed-point costs: a straight step costs FIXED_STRAIGHT and a diagonal step
+*   FIXED_DIAGONAL. 577 / 408 = 1.4142157 is within 2e-6 of sqrt(2), so the paths
+*   found have the same cost as the double search up to that ratio. g, h and the heap
+*   keys are uint32_t: half the memory of a double and integer compares. A path must
+*   stay below 4.2 billion / 408 = 10 million straight steps.
+* - octileDistance: the exact path cost on a map without obstacles, in fixed-point
+*   units, with no sqrt. Never larger than the real cost, and much tighter than the
+*   Euclidean distance.
+* - LandmarkHeuristic (ALT): costs from a few landmark cells to every cell, computed
+*   once per map. By the triangle inequality |d(L, n) - d(L, dest)| <= d(n, dest) for
+*   every landmark L, so the largest of these (and the octile distance) is still an
+*   admissible and consistent h. Landmarks behind the obstacles the search would run
+*   into give bounds far above the octile distance. Costs 4 bytes per cell per
+*   landmark, and must be rebuilt when the map changes.
+*/
+
+typedef uint32_t FixedCost;
+
+const FixedCost FIXED_STRAIGHT = 408;
+const FixedCost FIXED_DIAGONAL = 577;
+const FixedCost FIXED_INFINITY = std::numeric_limits<FixedCost>::max();
+const FixedCost FIXED_DIR_COST[8] = { FIXED_STRAIGHT, FIXED_STRAIGHT, FIXED_STRAIGHT, FIXED_STRAIGHT,
+	FIXED_DIAGONAL, FIXED_DIAGONAL, FIXED_DIAGONAL, FIXED_DIAGONAL };
+
+// Convert a fixed-point cost to the same units as aStarSearch
+inline double fixedToDouble(FixedCost cost)
+{
+	return (double)cost / FIXED_STRAIGHT;
+}
+
+// Cost of the best path to dest on a map without obstacles: diagonal steps while
+// both coordinates differ, straight steps for the rest
+inline FixedCost octileDistance(int row, int col, Pair dest)
+{
+	FixedCost dr = (FixedCost)std::abs(row - dest.first);
+	FixedCost dc = (FixedCost)std::abs(col - dest.second);
+	FixedCost lo = std::min(dr, dc), hi = std::max(dr, dc);
+	return lo * FIXED_DIAGONAL + (hi - lo) * FIXED_STRAIGHT;
+}
+
+// Per-search scratch for aStarSearchFixed, reused between queries like GridSearchState
+class FixedSearchState {
+private:
+	uint32_t generation = 0;
+	size_t expanded = 0;
+	std::vector<uint32_t> stamp;
+	std::vector<FixedCost> g;
+	std::vector<uint8_t> parentDir;
+	std::vector<uint8_t> closed;
+
+public:
+	IndexedDaryHeap<4, FixedCost> heap;
+
+	void reset(size_t cells)
+	{
+		if (stamp.size() != cells) {
+			stamp.assign(cells, 0);
+			g.resize(cells);
+			parentDir.resize(cells);
+			closed.resize(cells);
+			generation = 0;
+		}
+		if (++generation == 0) {
+			std::fill(stamp.begin(), stamp.end(), 0);
+			generation = 1;
+		}
+		heap.reserveItems(cells);
+		heap.clear();
+		expanded = 0;
+	}
+
+	size_t getExpanded() const { return expanded; }
+
+	bool isVisited(size_t cell) const { return stamp[cell] == generation; }
+	bool isClosed(size_t cell) const { return isVisited(cell) && closed[cell]; }
+	FixedCost getG(size_t cell) const { return isVisited(cell) ? g[cell] : FIXED_INFINITY; }
+	uint8_t getParentDir(size_t cell) const { return parentDir[cell]; }
+
+	void open(size_t cell, FixedCost gValue, uint8_t dir)
+	{
+		stamp[cell] = generation;
+		g[cell] = gValue;
+		parentDir[cell] = dir;
+		closed[cell] = 0;
+	}
+
+	void close(size_t cell)
+	{
+		closed[cell] = 1;
+		expanded++;
+	}
+};
+
+// Fixed-point cost from one cell to every cell of the map (Dijkstra).
+// Unreachable and blocked cells get FIXED_INFINITY.
+inline void fixedDistances(const GridMap& grid, Pair src, FixedSearchState& state, std::vector<FixedCost>& dist)
+{
+	dist.assign(grid.size(), FIXED_INFINITY);
+	state.reset(grid.size());
+	size_t first = grid.index(src.first, src.second);
+	state.open(first, 0, GridSearchState::NO_PARENT);
+	state.heap.push((uint32_t)first, 0);
+
+	while (!state.heap.empty()) {
+		uint32_t current = state.heap.pop();
+		state.close(current);
+		FixedCost g = state.getG(current);
+		dist[current] = g;
+		int i = grid.rowOf(current);
+		int j = grid.colOf(current);
+		for (uint8_t d = 0; d < 8; d++) {
+			int row = i + DIR_ROW[d];
+			int col = j + DIR_COL[d];
+			if (!grid.isValid(row, col) || !grid.isUnBlocked(row, col))
+				continue;
+			size_t next = grid.index(row, col);
+			FixedCost gNew = g + FIXED_DIR_COST[d];
+			if (!state.isClosed(next) && gNew < state.getG(next)) {
+				state.open(next, gNew, d);
+				state.heap.pushOrDecrease((uint32_t)next, gNew);
+			}
+		}
+	}
+}
+
+class LandmarkHeuristic {
+private:
+	const GridMap& grid;
+	std::vector<Pair> landmarks;
+	std::vector<std::vector<FixedCost>> dist; // dist[k][cell]: cost from landmarks[k]
+
+	// Labels the connected components of the free cells (8-connected, as the searches
+	// move): component[cell] is the index of its component, -1 for blocked cells. For
+	// every component, sizes gets its number of cells and corners its cell closest to
+	// the (0, 0) corner.
+	static std::vector<int> findComponents(const GridMap& grid, std::vector<size_t>& sizes,
+		std::vector<size_t>& corners)
+	{
+		std::vector<int> component(grid.size(), -1);
+		std::vector<size_t> queue;
+		for (size_t start = 0; start < grid.size(); start++) {
+			if (component[start] >= 0 || !grid.isUnBlocked(grid.rowOf(start), grid.colOf(start)))
+				continue;
+			int label = (int)sizes.size();
+			size_t corner = start;
+			component[start] = label;
+			queue.assign(1, start);
+			for (size_t head = 0; head < queue.size(); head++) {
+				size_t cell = queue[head];
+				int i = grid.rowOf(cell);
+				int j = grid.colOf(cell);
+				if (i + j < grid.rowOf(corner) + grid.colOf(corner))
+					corner = cell;
+				for (uint8_t d = 0; d < 8; d++) {
+					int row = i + DIR_ROW[d];
+					int col = j + DIR_COL[d];
+					if (!grid.isValid(row, col) || !grid.isUnBlocked(row, col))
+						continue;
+					size_t next = grid.index(row, col);
+					if (component[next] < 0) {
+						component[next] = label;
+						queue.push_back(next);
+					}
+				}
+			}
+			sizes.push_back(queue.size());
+			corners.push_back(corner);
+		}
+		return component;
+	}
+
+public:
+	// Picks `count` landmarks by farthest-point selection: start from the cell of the
+	// largest connected area closest to a corner, then repeatedly add the cell whose
+	// cost to the nearest landmark chosen so far is largest. Landmarks end up on the
+	// edges of the map and behind large obstacles, which is where they give the
+	// tightest bounds. Once every cell reachable from the landmarks is one, the next
+	// landmark goes to the largest area none of them reaches.
+	LandmarkHeuristic(const GridMap& grid, int count)
+		: grid(grid)
+	{
+		std::vector<size_t> sizes, corners;
+		std::vector<int> component = findComponents(grid, sizes, corners);
+		std::vector<bool> covered(sizes.size(), false); // Components holding a landmark
+		auto largestUncovered = [&]() {
+			int largest = -1;
+			for (size_t c = 0; c < sizes.size(); c++)
+				if (!covered[c] && (largest < 0 || sizes[c] > sizes[largest]))
+					largest = (int)c;
+			return largest;
+		};
+		int first = largestUncovered();
+		if (first < 0)
+			return;
+
+		FixedSearchState state;
+		std::vector<FixedCost> nearest(grid.size(), FIXED_INFINITY);
+		Pair next(grid.rowOf(corners[first]), grid.colOf(corners[first]));
+		for (int k = 0; k < count; k++) {
+			landmarks.push_back(next);
+			covered[component[grid.index(next.first, next.second)]] = true;
+			dist.emplace_back();
+			fixedDistances(grid, next, state, dist.back());
+
+			// Farthest reachable cell from every landmark chosen so far
+			FixedCost best = 0;
+			for (size_t cell = 0; cell < grid.size(); cell++) {
+				nearest[cell] = std::min(nearest[cell], dist.back()[cell]);
+				if (nearest[cell] != FIXED_INFINITY && nearest[cell] > best) {
+					best = nearest[cell];
+					next = Pair(grid.rowOf(cell), grid.colOf(cell));
+				}
+			}
+			if (best == 0) {
+				int c = largestUncovered();
+				if (c < 0)
+					break; // Every free cell is a landmark
+				next = Pair(grid.rowOf(corners[c]), grid.colOf(corners[c]));
+			}
+		}
+	}
+
+	const std::vector<Pair>& getLandmarks() const { return landmarks; }
+
+	// Admissible estimate of the cost from (row, col) to dest. FIXED_INFINITY means
+	// dest cannot be reached: a landmark reaches one of the cells but not the other.
+	// Read-only, so one instance can serve searches on several threads.
+	FixedCost estimate(int row, int col, Pair dest) const
+	{
+		size_t cell = grid.index(row, col);
+		size_t target = grid.index(dest.first, dest.second);
+		FixedCost h = octileDistance(row, col, dest);
+		for (size_t k = 0; k < landmarks.size(); k++) {
+			FixedCost a = dist[k][cell], b = dist[k][target];
+			if (a == FIXED_INFINITY || b == FIXED_INFINITY) {
+				if (a != b)
+					return FIXED_INFINITY;
+				continue;
+			}
+			h = std::max(h, a > b ? a - b : b - a);
+		}
+		return h;
+	}
+};
+
+// A* with fixed-point costs and the octile heuristic, or the landmark heuristic when
+// one is given. Same contract as aStarSearch; the cost of the path returned is
+// optimal for FIXED_DIR_COST. The landmarks must have been built for this map.
+inline std::vector<Pair> aStarSearchFixed(const GridMap& grid, Pair src, Pair dest, FixedSearchState& state,
+	const LandmarkHeuristic* landmarks = nullptr)
+{
+	// Either the source or the destination is out of range or blocked
+	if (!grid.isValid(src.first, src.second) || !grid.isValid(dest.first, dest.second)
+		|| !grid.isUnBlocked(src.first, src.second) || !grid.isUnBlocked(dest.first, dest.second))
+		return std::vector<Pair>();
+
+	state.reset(grid.size());
+	size_t first = grid.index(src.first, src.second);
+	state.open(first, 0, GridSearchState::NO_PARENT);
+	state.heap.push((uint32_t)first, 0);
+
+	while (!state.heap.empty()) {
+		uint32_t current = state.heap.pop();
+		int i = grid.rowOf(current);
+		int j = grid.colOf(current);
+
+		if (i == dest.first && j == dest.second) {
+			// Walk the parent directions back, as tracePath does
+			std::vector<Pair> path;
+			uint8_t dir;
+			while ((dir = state.getParentDir(grid.index(i, j))) != GridSearchState::NO_PARENT) {
+				path.push_back(Pair(i, j));
+				i -= DIR_ROW[dir];
+				j -= DIR_COL[dir];
+			}
+			path.push_back(Pair(i, j));
+			std::reverse(path.begin(), path.end());
+			return path;
+		}
+
+		state.close(current);
+		FixedCost g = state.getG(current);
+
+		for (uint8_t d = 0; d < 8; d++) {
+			int row = i + DIR_ROW[d];
+			int col = j + DIR_COL[d];
+			if (!grid.isValid(row, col) || !grid.isUnBlocked(row, col))
+				continue;
+			size_t next = grid.index(row, col);
+			if (state.isClosed(next))
+				continue;
+
+			FixedCost gNew = g + FIXED_DIR_COST[d];
+			if (gNew < state.getG(next)) {
+				FixedCost h = landmarks ? landmarks->estimate(row, col, dest) : octileDistance(row, col, dest);
+				if (h == FIXED_INFINITY)
+					continue;
+				state.open(next, gNew, d);
+				state.heap.pushOrDecrease((uint32_t)next, gNew + h);
+			}
+		}
+	}
+
+	// The open list is empty: there is no way to the destination cell (due to blockages)
+	return std::vector<Pair>();
+}
+
+#endif
@@ -0,0 +1,305 @@
+// GridPathfinding.h
+// Runtime-sized grid map and A* search used by AStarSearchAlgorithm.cpp
+
+#ifndef GRIDPATHFINDING_H
+#define GRIDPATHFINDING_H
+
+#include <vector>
+#include <set>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
+#include "IndexedHeap.h"
+
+// Creating a shortcut for int, int pair type
+typedef std::pair<int, int> Pair;
+
+// Creating a shortcut for pair<double, cell index> type
+typedef std::pair<double, uint32_t> pPair;
+
+// Data structure used for the A* open list
+enum OpenListType {
+	SET_OPEN_LIST,         // std::set<pPair>: a tree node allocation per push, stale entries skipped when popped
+	BINARY_HEAP_OPEN_LIST, // IndexedDaryHeap<2> with decrease-key
+	QUAD_HEAP_OPEN_LIST    // IndexedDaryHeap<4> with decrease-key
+};
+
+// Cost of a diagonal step. sqrt(2) keeps the Euclidean heuristic admissible.
+const double DIAGONAL_COST = 1.4142135623730951;
+
+// The 8 moves of a cell: N, S, E, W, N.E, N.W, S.E, S.W
+const int DIR_ROW[8] = { -1, 1, 0, 0, -1, -1, 1, 1 };
+const int DIR_COL[8] = { 0, 0, 1, -1, 1, -1, 1, -1 };
+const double DIR_COST[8] = { 1.0, 1.0, 1.0, 1.0, DIAGONAL_COST, DIAGONAL_COST, DIAGONAL_COST, DIAGONAL_COST };
+
+// Occupancy grid whose size is chosen at runtime.
+// Cells are stored row-major as one bit each (1 = not blocked, 0 = blocked),
+// so a 10k x 10k map takes 12.5 MB.
+class GridMap {
+private:
+	int rows, cols;
+	std::vector<uint64_t> bits;
+
+public:
+	// Creates a map of the given size with every cell unblocked
+	GridMap(int rows, int cols)
+		: rows(rows), cols(cols), bits(((size_t)rows * cols + 63) / 64, ~0ULL)
+	{
+	}
+
+	// Creates a map from a row-major array using the same convention as the
+	// old int grid[ROW][COL]: 1 --> not blocked, 0 --> blocked
+	GridMap(int rows, int cols, const int* cells)
+		: rows(rows), cols(cols), bits(((size_t)rows * cols + 63) / 64, 0)
+	{
+		for (int i = 0; i < rows; i++)
+			for (int j = 0; j < cols; j++)
+				setBlocked(i, j, cells[(size_t)i * cols + j] != 1);
+	}
+
+	int getRows() const { return rows; }
+	int getCols() const { return cols; }
+	size_t size() const { return (size_t)rows * cols; }
+
+	// Row-major index of cell (row, col)
+	size_t index(int row, int col) const { return (size_t)row * cols + col; }
+	int rowOf(size_t index) const { return (int)(index / cols); }
+	int colOf(size_t index) const { return (int)(index % cols); }
+
+	// Check whether given cell (row, col) is inside the map
+	bool isValid(int row, int col) const
+	{
+		return (row >= 0) && (row < rows) && (col >= 0) && (col < cols);
+	}
+
+	// Check whether the given cell is blocked or not
+	bool isUnBlocked(int row, int col) const
+	{
+		size_t k = index(row, col);
+		return (bits[k >> 6] >> (k & 63)) & 1;
+	}
+
+	void setBlocked(int row, int col, bool blocked)
+	{
+		size_t k = index(row, col);
+		if (blocked)
+			bits[k >> 6] &= ~(1ULL << (k & 63));
+		else
+			bits[k >> 6] |= 1ULL << (k & 63);
+	}
+};
+
+// Per-search scratch (g costs, parents, closed flags) that is reused between queries.
+// Each cell remembers the generation it was last written in; anything older counts as
+// unvisited, so starting a new search increments a counter instead of clearing every cell.
+class GridSearchState {
+private:
+	uint32_t generation = 0;
+	size_t expanded = 0;
+	std::vector<uint32_t> stamp;
+	std::vector<double> g;
+	std::vector<uint8_t> parentDir; // Index into DIR_ROW/DIR_COL of the move that reached the cell, NO_PARENT for the source
+	std::vector<uint8_t> closed;
+
+public:
+	static const uint8_t NO_PARENT = 8;
+
+	// Cell index of the parent, for searches whose moves span more than one cell
+	// (Jump Point Search). Only allocated by reset(cells, true) and only valid for
+	// visited cells.
+	std::vector<uint32_t> parentCell;
+
+	// Open lists, kept here so their storage is reused by the next search
+	std::set<pPair> openSet;
+	IndexedDaryHeap<2> binaryHeap;
+	IndexedDaryHeap<4> quadHeap;
+
+	// Prepares the state for a new search on a map with the given number of cells
+	void reset(size_t cells, bool withParentCells = false)
+	{
+		if (withParentCells && parentCell.size() != cells)
+			parentCell.resize(cells);
+		if (stamp.size() != cells) {
+			stamp.assign(cells, 0);
+			g.resize(cells);
+			parentDir.resize(cells);
+			closed.resize(cells);
+			generation = 0;
+		}
+		if (++generation == 0) {
+			// The counter wrapped around, old stamps could alias the new generation
+			std::fill(stamp.begin(), stamp.end(), 0);
+			generation = 1;
+		}
+		expanded = 0;
+	}
+
+	// Number of cells closed by the last search
+	size_t getExpanded() const { return expanded; }
+
+	bool isVisited(size_t cell) const { return stamp[cell] == generation; }
+	bool isClosed(size_t cell) const { return isVisited(cell) && closed[cell]; }
+	double getG(size_t cell) const { return isVisited(cell) ? g[cell] : std::numeric_limits<double>::infinity(); }
+	uint8_t getParentDir(size_t cell) const { return parentDir[cell]; }
+
+	void open(size_t cell, double gValue, uint8_t dir)
+	{
+		stamp[cell] = generation;
+		g[cell] = gValue;
+		parentDir[cell] = dir;
+		closed[cell] = 0;
+	}
+
+	void close(size_t cell)
+	{
+		closed[cell] = 1;
+		expanded++;
+	}
+};
+
+// Calculate the 'h' heuristics.
+inline double calculateHValue(int row, int col, Pair dest)
+{
+	// Return using the distance formula
+	return ((double)std::sqrt(
+		(double)(row - dest.first) * (row - dest.first)
+		+ (double)(col - dest.second) * (col - dest.second)));
+}
+
+// Walk the parent directions back from dest and return the path from the source
+inline std::vector<Pair> tracePath(const GridMap& grid, const GridSearchState& state, Pair dest)
+{
+	std::vector<Pair> path;
+	int row = dest.first;
+	int col = dest.second;
+	uint8_t dir;
+
+	while ((dir = state.getParentDir(grid.index(row, col))) != GridSearchState::NO_PARENT) {
+		path.push_back(Pair(row, col));
+		row -= DIR_ROW[dir];
+		col -= DIR_COL[dir];
+	}
+	path.push_back(Pair(row, col));
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+// Open list adapters used by aStarSearchWith: clear / empty / push (insert or
+// decrease the f of a queued cell) / pop (remove the cell with the smallest f)
+class SetOpenList {
+private:
+	std::set<pPair>& openList;
+
+public:
+	SetOpenList(std::set<pPair>& openList) : openList(openList) {}
+	void clear() { openList.clear(); }
+	bool empty() const { return openList.empty(); }
+	// A set cannot change a key in place, so a better path adds a second entry
+	void push(uint32_t cell, double f) { openList.insert(std::make_pair(f, cell)); }
+	uint32_t pop()
+	{
+		uint32_t cell = openList.begin()->second;
+		openList.erase(openList.begin());
+		return cell;
+	}
+};
+
+template <int D>
+class HeapOpenList {
+private:
+	IndexedDaryHeap<D>& heap;
+
+public:
+	HeapOpenList(IndexedDaryHeap<D>& heap, size_t cells) : heap(heap) { heap.reserveItems(cells); }
+	void clear() { heap.clear(); }
+	bool empty() const { return heap.empty(); }
+	void push(uint32_t cell, double f) { heap.pushOrDecrease(cell, f); }
+	uint32_t pop() { return heap.pop(); }
+};
+
+// A* over any open list adapter. See aStarSearch below.
+template <class OpenList>
+std::vector<Pair> aStarSearchWith(const GridMap& grid, Pair src, Pair dest, GridSearchState& state, OpenList openList)
+{
+	state.reset(grid.size());
+	state.open(grid.index(src.first, src.second), 0.0, GridSearchState::NO_PARENT);
+
+	// Open list of cells keyed by f = g + h
+	openList.clear();
+	openList.push((uint32_t)grid.index(src.first, src.second), 0.0);
+
+	while (!openList.empty()) {
+		// Remove the vertex with the smallest f from the open list
+		uint32_t current = openList.pop();
+		if (state.isClosed(current))
+			continue;
+
+		int i = grid.rowOf(current);
+		int j = grid.colOf(current);
+
+		// The destination is only final once it is taken off the open list
+		if (i == dest.first && j == dest.second)
+			return tracePath(grid, state, dest);
+
+		// Add this vertex to the closed list
+		state.close(current);
+
+		// Generating all the 8 successor of this cell
+		for (uint8_t d = 0; d < 8; d++) {
+			int row = i + DIR_ROW[d];
+			int col = j + DIR_COL[d];
+
+			// Skip cells that are outside the map, blocked or already closed
+			if (!grid.isValid(row, col) || !grid.isUnBlocked(row, col))
+				continue;
+			size_t next = grid.index(row, col);
+			if (state.isClosed(next))
+				continue;
+
+			double gNew = state.getG(current) + DIR_COST[d];
+
+			// If it isn't on the open list, or this path to it is better,
+			// record the new cost and parent and (re)insert it
+			if (gNew < state.getG(next)) {
+				state.open(next, gNew, d);
+				openList.push((uint32_t)next, gNew + calculateHValue(row, col, dest));
+			}
+		}
+	}
+
+	// The open list is empty: there is no way to the destination cell (due to blockages)
+	return std::vector<Pair>();
+}
+
+// Find the shortest path between the source cell and the destination cell
+// according to A* Search Algorithm. Returns the cells of the path from src to
+// dest inclusive, or an empty vector when either end is invalid or blocked or
+// no path exists. The state can be reused by the next call.
+inline std::vector<Pair> aStarSearch(const GridMap& grid, Pair src, Pair dest, GridSearchState& state,
+	OpenListType openListType = QUAD_HEAP_OPEN_LIST)
+{
+	// Either the source or the destination is out of range or blocked
+	if (!grid.isValid(src.first, src.second) || !grid.isValid(dest.first, dest.second)
+		|| !grid.isUnBlocked(src.first, src.second) || !grid.isUnBlocked(dest.first, dest.second))
+		return std::vector<Pair>();
+
+	switch (openListType) {
+	case SET_OPEN_LIST:
+		return aStarSearchWith(grid, src, dest, state, SetOpenList(state.openSet));
+	case BINARY_HEAP_OPEN_LIST:
+		return aStarSearchWith(grid, src, dest, state, HeapOpenList<2>(state.binaryHeap, grid.size()));
+	default:
+		return aStarSearchWith(grid, src, dest, state, HeapOpenList<4>(state.quadHeap, grid.size()));
+	}
+}
+
+// Convenience overload for a single query
+inline std::vector<Pair> aStarSearch(const GridMap& grid, Pair src, Pair dest,
+	OpenListType openListType = QUAD_HEAP_OPEN_LIST)
+{
+	GridSearchState state;
+	return aStarSearch(grid, src, dest, state, openListType);
+}
+
+#endif
@@ -0,0 +1,561 @@
+// HierarchicalPathfinding.h
+// HPA* (Botea, Mueller & Schaeffer): A* over an abstract graph of cluster entrances
+
+#ifndef HIERARCHICALPATHFINDING_H
+#define HIERARCHICALPATHFINDING_H
+
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <unordered_map>
+#include "GridPathfinding.h"
+
+/*
+* HPA* splits the map into square clusters and only searches the cells of one cluster
+* at a time:
+*
+* 1. Abstraction (built once, in the constructor):
+*    - For the border between two neighbouring clusters, every run of cells that is free
+*      on both sides is an entrance. Short runs (< 6 cells) get one transition in the
+*      middle, longer runs one at each end. The two cells of a transition become abstract
+*      nodes joined by an inter-cluster edge of cost 1. Where cells only connect across
+*      the border diagonally, a diagonal transition is added instead.
+*    - Where four clusters meet, a diagonal step through the shared corner gets a
+*      transition of its own when it cannot be replaced by two straight steps.
+*    - Inside each cluster, a Dijkstra search restricted to the cluster gives the cost
+*      between every pair of its abstract nodes (intra-cluster edges). These costs are
+*      cached in the graph.
+* 2. Query (findPath):
+*    - When the source and the destination are in the same or neighbouring clusters, a
+*      search restricted to those clusters and the ones around them is tried first: over
+*      such short distances, going through the entrances can cost several times the
+*      optimum.
+*    - Otherwise the source and the destination are connected to the nodes of their own clusters
+*      with one restricted search each, then A* runs on the abstract graph.
+*    - Refinement turns every intra-cluster edge of the abstract path back into cells
+*      with a restricted A* inside that cluster.
+* 3. Incremental re-abstraction (setBlocked):
+*    - Changing a cell only rebuilds the borders the cell lies on and the intra-cluster
+*      edges of the clusters next to those borders; the rest of the graph is reused.
+*
+* Paths are near-optimal (typically within a few percent) rather than optimal, because
+* routes are forced through the entrance cells.
+*/
+
+// Cells [row0, row1) x [col0, col1) of one cluster
+struct ClusterBounds {
+	int row0, col0, row1, col1;
+
+	bool contains(int row, int col) const
+	{
+		return row >= row0 && row < row1 && col >= col0 && col < col1;
+	}
+
+	size_t size() const { return (size_t)(row1 - row0) * (col1 - col0); }
+
+	// Index of a cell in cluster-sized search state, so restricted searches touch a
+	// small contiguous block instead of rows scattered across the whole map
+	size_t localIndex(int row, int col) const { return (size_t)(row - row0) * (col1 - col0) + (col - col0); }
+	int rowOf(size_t local) const { return row0 + (int)(local / (col1 - col0)); }
+	int colOf(size_t local) const { return col0 + (int)(local % (col1 - col0)); }
+};
+
+// A* (Dijkstra when dest is outside the bounds) that never leaves the bounds.
+// Returns true when dest was reached; g costs and parents are left in the state,
+// indexed by bounds.localIndex.
+inline bool boundedSearch(const GridMap& grid, Pair src, Pair dest, const ClusterBounds& bounds, GridSearchState& state)
+{
+	bool hasDest = bounds.contains(dest.first, dest.second);
+	state.reset(bounds.size());
+	state.open(bounds.localIndex(src.first, src.second), 0.0, GridSearchState::NO_PARENT);
+
+	HeapOpenList<4> openList(state.quadHeap, bounds.size());
+	openList.clear();
+	openList.push((uint32_t)bounds.localIndex(src.first, src.second), 0.0);
+
+	while (!openList.empty()) {
+		uint32_t current = openList.pop();
+		int i = bounds.rowOf(current);
+		int j = bounds.colOf(current);
+		if (hasDest && i == dest.first && j == dest.second)
+			return true;
+		state.close(current);
+
+		for (uint8_t d = 0; d < 8; d++) {
+			int row = i + DIR_ROW[d];
+			int col = j + DIR_COL[d];
+			if (!bounds.contains(row, col) || !grid.isUnBlocked(row, col))
+				continue;
+			size_t next = bounds.localIndex(row, col);
+			if (state.isClosed(next))
+				continue;
+			double gNew = state.getG(current) + DIR_COST[d];
+			if (gNew < state.getG(next)) {
+				state.open(next, gNew, d);
+				openList.push((uint32_t)next, gNew + (hasDest ? calculateHValue(row, col, dest) : 0.0));
+			}
+		}
+	}
+	return false;
+}
+
+// Path from the source of the last boundedSearch to dest
+inline std::vector<Pair> traceBoundedPath(const ClusterBounds& bounds, const GridSearchState& state, Pair dest)
+{
+	std::vector<Pair> path;
+	int row = dest.first;
+	int col = dest.second;
+	uint8_t dir;
+
+	while ((dir = state.getParentDir(bounds.localIndex(row, col))) != GridSearchState::NO_PARENT) {
+		path.push_back(Pair(row, col));
+		row -= DIR_ROW[dir];
+		col -= DIR_COL[dir];
+	}
+	path.push_back(Pair(row, col));
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+class HierarchicalPathfinder {
+private:
+	struct Edge {
+		uint32_t to;
+		double cost;
+	};
+
+	struct AbstractNode {
+		uint32_t cell;
+		int cluster;
+		int borders; // Number of borders with a transition on this cell, the node is freed at 0
+		std::vector<Edge> interEdges;
+		std::vector<Edge> intraEdges;
+	};
+
+	struct Transition {
+		uint32_t inside, outside; // Node ids on either side of the border
+	};
+
+	GridMap& grid;
+	int clusterSize;
+	int clusterRows, clusterCols;
+
+	std::vector<AbstractNode> nodes;
+	std::vector<uint32_t> freeNodes;
+	std::unordered_map<uint32_t, uint32_t> nodeOfCell;
+	std::vector<std::vector<uint32_t> > clusterNodes;
+	// Border b = 3 * cluster + 0 is the one to the right of the cluster, 3 * cluster + 1 the one below
+	// and 3 * cluster + 2 the corner below and to the right, where four clusters meet
+	std::vector<std::vector<Transition> > borderTransitions;
+
+	// Scratch for queries and re-abstraction
+	GridSearchState cellState;
+	std::vector<uint32_t> searchStamp;
+	std::vector<double> searchG;
+	std::vector<uint32_t> searchParent;
+	uint32_t searchGeneration = 0;
+	IndexedDaryHeap<4> abstractHeap;
+	size_t expanded = 0;
+
+	int clusterOf(int row, int col) const
+	{
+		return (row / clusterSize) * clusterCols + col / clusterSize;
+	}
+
+	ClusterBounds boundsOf(int cluster) const
+	{
+		int row0 = (cluster / clusterCols) * clusterSize;
+		int col0 = (cluster % clusterCols) * clusterSize;
+		return ClusterBounds{ row0, col0, std::min(row0 + clusterSize, grid.getRows()), std::min(col0 + clusterSize, grid.getCols()) };
+	}
+
+	uint32_t acquireNode(int row, int col)
+	{
+		uint32_t cell = (uint32_t)grid.index(row, col);
+		std::unordered_map<uint32_t, uint32_t>::iterator found = nodeOfCell.find(cell);
+		if (found != nodeOfCell.end()) {
+			nodes[found->second].borders++;
+			return found->second;
+		}
+
+		uint32_t id;
+		if (!freeNodes.empty()) {
+			id = freeNodes.back();
+			freeNodes.pop_back();
+		}
+		else {
+			id = (uint32_t)nodes.size();
+			nodes.push_back(AbstractNode());
+		}
+		AbstractNode& node = nodes[id];
+		node.cell = cell;
+		node.cluster = clusterOf(row, col);
+		node.borders = 1;
+		node.interEdges.clear();
+		node.intraEdges.clear();
+		nodeOfCell[cell] = id;
+		clusterNodes[node.cluster].push_back(id);
+		return id;
+	}
+
+	void releaseNode(uint32_t id)
+	{
+		AbstractNode& node = nodes[id];
+		if (--node.borders > 0)
+			return;
+		std::vector<uint32_t>& members = clusterNodes[node.cluster];
+		members.erase(std::find(members.begin(), members.end(), id));
+		nodeOfCell.erase(node.cell);
+		node.interEdges.clear();
+		node.intraEdges.clear();
+		freeNodes.push_back(id);
+	}
+
+	static void removeEdge(std::vector<Edge>& edges, uint32_t to)
+	{
+		for (size_t k = 0; k < edges.size(); k++)
+			if (edges[k].to == to) {
+				edges.erase(edges.begin() + k);
+				return;
+			}
+	}
+
+	void addTransition(int border, int ri, int ci, int ro, int co, double cost)
+	{
+		Transition t;
+		t.inside = acquireNode(ri, ci);
+		t.outside = acquireNode(ro, co);
+		nodes[t.inside].interEdges.push_back(Edge{ t.outside, cost });
+		nodes[t.outside].interEdges.push_back(Edge{ t.inside, cost });
+		borderTransitions[border].push_back(t);
+	}
+
+	// Diagonal steps through the point where four clusters meet. When one of the two
+	// other cells around that point is free, the step can be made as two straight steps
+	// across the borders instead, which have transitions of their own.
+	void buildCorner(int border)
+	{
+		ClusterBounds b = boundsOf(border / 3);
+		if (b.row1 >= grid.getRows() || b.col1 >= grid.getCols())
+			return; // No diagonal neighbour
+		int r = b.row1 - 1, c = b.col1 - 1; // Last cell of the cluster
+		bool topLeft = grid.isUnBlocked(r, c), topRight = grid.isUnBlocked(r, c + 1);
+		bool bottomLeft = grid.isUnBlocked(r + 1, c), bottomRight = grid.isUnBlocked(r + 1, c + 1);
+		if (topLeft && bottomRight && !topRight && !bottomLeft)
+			addTransition(border, r, c, r + 1, c + 1, DIAGONAL_COST);
+		if (topRight && bottomLeft && !topLeft && !bottomRight)
+			addTransition(border, r, c + 1, r + 1, c, DIAGONAL_COST);
+	}
+
+	// Find the entrances of one border and create their nodes and inter-cluster edges
+	void buildBorder(int border)
+	{
+		if (border % 3 == 2) {
+			buildCorner(border);
+			return;
+		}
+		int cluster = border / 3;
+		bool right = border % 3 == 0;
+		ClusterBounds b = boundsOf(cluster);
+		if (right ? b.col1 >= grid.getCols() : b.row1 >= grid.getRows())
+			return; // No neighbour on that side
+
+		// Cell k of the border on the inside and on the outside
+		int length = right ? b.row1 - b.row0 : b.col1 - b.col0;
+		int runStart = -1;
+		for (int k = 0; k <= length; k++) {
+			bool open = false;
+			if (k < length) {
+				int ri = right ? b.row0 + k : b.row1 - 1, ci = right ? b.col1 - 1 : b.col0 + k;
+				int ro = right ? ri : b.row1, co = right ? b.col1 : ci;
+				open = grid.isUnBlocked(ri, ci) && grid.isUnBlocked(ro, co);
+			}
+			if (open && runStart < 0)
+				runStart = k;
+			if (!open && runStart >= 0) {
+				int picks[2] = { (runStart + k - 1) / 2, -1 };
+				if (k - runStart >= 6) {
+					picks[0] = runStart;
+					picks[1] = k - 1;
+				}
+				for (int p = 0; p < 2 && picks[p] >= 0; p++) {
+					int ri = right ? b.row0 + picks[p] : b.row1 - 1, ci = right ? b.col1 - 1 : b.col0 + picks[p];
+					int ro = right ? ri : b.row1, co = right ? b.col1 : ci;
+					addTransition(border, ri, ci, ro, co, 1.0);
+				}
+				runStart = -1;
+			}
+		}
+
+		// Diagonal-only crossings: inside k and outside k + 1 (or the reverse) are free,
+		// but neither k nor k + 1 is open straight across
+		for (int k = 0; k + 1 < length; k++) {
+			int ri0 = right ? b.row0 + k : b.row1 - 1, ci0 = right ? b.col1 - 1 : b.col0 + k;
+			int ri1 = right ? ri0 + 1 : ri0, ci1 = right ? ci0 : ci0 + 1;
+			int ro0 = right ? ri0 : b.row1, co0 = right ? b.col1 : ci0;
+			int ro1 = right ? ri1 : b.row1, co1 = right ? b.col1 : ci1;
+			if ((grid.isUnBlocked(ri0, ci0) && grid.isUnBlocked(ro0, co0)) || (grid.isUnBlocked(ri1, ci1) && grid.isUnBlocked(ro1, co1)))
+				continue;
+			if (grid.isUnBlocked(ri0, ci0) && grid.isUnBlocked(ro1, co1))
+				addTransition(border, ri0, ci0, ro1, co1, DIAGONAL_COST);
+			if (grid.isUnBlocked(ri1, ci1) && grid.isUnBlocked(ro0, co0))
+				addTransition(border, ri1, ci1, ro0, co0, DIAGONAL_COST);
+		}
+	}
+
+	// Clusters whose abstract nodes a border may add or remove
+	std::vector<int> clustersAround(int border) const
+	{
+		int cluster = border / 3, side = border % 3;
+		bool hasRight = cluster % clusterCols + 1 < clusterCols, hasBelow = cluster / clusterCols + 1 < clusterRows;
+		std::vector<int> clusters(1, cluster);
+		if (side != 1 && hasRight)
+			clusters.push_back(cluster + 1);
+		if (side != 0 && hasBelow)
+			clusters.push_back(cluster + clusterCols);
+		if (side == 2 && hasRight && hasBelow)
+			clusters.push_back(cluster + clusterCols + 1);
+		return clusters;
+	}
+
+	void clearBorder(int border)
+	{
+		std::vector<Transition>& transitions = borderTransitions[border];
+		for (size_t k = 0; k < transitions.size(); k++) {
+			removeEdge(nodes[transitions[k].inside].interEdges, transitions[k].outside);
+			removeEdge(nodes[transitions[k].outside].interEdges, transitions[k].inside);
+			releaseNode(transitions[k].inside);
+			releaseNode(transitions[k].outside);
+		}
+		transitions.clear();
+	}
+
+	// Cache the cost between every pair of abstract nodes of a cluster
+	void buildIntraEdges(int cluster)
+	{
+		const std::vector<uint32_t>& members = clusterNodes[cluster];
+		ClusterBounds b = boundsOf(cluster);
+		for (size_t u = 0; u < members.size(); u++)
+			nodes[members[u]].intraEdges.clear();
+		for (size_t u = 0; u < members.size(); u++) {
+			AbstractNode& from = nodes[members[u]];
+			boundedSearch(grid, Pair(grid.rowOf(from.cell), grid.colOf(from.cell)), Pair(-1, -1), b, cellState);
+			for (size_t v = 0; v < members.size(); v++) {
+				uint32_t cell = nodes[members[v]].cell;
+				double cost = cellState.getG(b.localIndex(grid.rowOf(cell), grid.colOf(cell)));
+				if (v != u && cost < std::numeric_limits<double>::infinity())
+					from.intraEdges.push_back(Edge{ members[v], cost });
+			}
+		}
+	}
+
+	// Distances from a cell to the abstract nodes of its cluster
+	std::vector<Edge> connect(Pair cell, int cluster)
+	{
+		std::vector<Edge> edges;
+		ClusterBounds b = boundsOf(cluster);
+		boundedSearch(grid, cell, Pair(-1, -1), b, cellState);
+		const std::vector<uint32_t>& members = clusterNodes[cluster];
+		for (size_t v = 0; v < members.size(); v++) {
+			uint32_t node = nodes[members[v]].cell;
+			double cost = cellState.getG(b.localIndex(grid.rowOf(node), grid.colOf(node)));
+			if (cost < std::numeric_limits<double>::infinity())
+				edges.push_back(Edge{ members[v], cost });
+		}
+		return edges;
+	}
+
+	// Append the cells from `from` (exclusive) to `to` (inclusive), searching inside one cluster
+	bool refine(Pair from, Pair to, std::vector<Pair>& path)
+	{
+		if (from == to)
+			return true;
+		ClusterBounds b = boundsOf(clusterOf(from.first, from.second));
+		if (!boundedSearch(grid, from, to, b, cellState))
+			return false;
+		std::vector<Pair> segment = traceBoundedPath(b, cellState, to);
+		path.insert(path.end(), segment.begin() + 1, segment.end());
+		return true;
+	}
+
+public:
+	HierarchicalPathfinder(GridMap& grid, int clusterSize = 32)
+		: grid(grid), clusterSize(clusterSize),
+		  clusterRows((grid.getRows() + clusterSize - 1) / clusterSize),
+		  clusterCols((grid.getCols() + clusterSize - 1) / clusterSize),
+		  clusterNodes((size_t)clusterRows * clusterCols),
+		  borderTransitions((size_t)clusterRows * clusterCols * 3)
+	{
+		for (size_t border = 0; border < borderTransitions.size(); border++)
+			buildBorder((int)border);
+		for (size_t cluster = 0; cluster < clusterNodes.size(); cluster++)
+			buildIntraEdges((int)cluster);
+	}
+
+	size_t getNodeCount() const { return nodeOfCell.size(); }
+
+	// Work of the last findPath: abstract nodes expanded, plus the cells expanded by the
+	// direct search when src and dest are in the same or neighbouring clusters
+	size_t getExpanded() const { return expanded; }
+
+	// Block or unblock a cell and repair the abstraction around it
+	void setBlocked(int row, int col, bool blocked)
+	{
+		if (grid.isUnBlocked(row, col) == !blocked)
+			return;
+		grid.setBlocked(row, col, blocked);
+
+		int cluster = clusterOf(row, col);
+		ClusterBounds b = boundsOf(cluster);
+		std::vector<int> borders, clusters(1, cluster);
+		bool left = col == b.col0 && b.col0 > 0, right = col == b.col1 - 1;
+		bool top = row == b.row0 && b.row0 > 0, bottom = row == b.row1 - 1;
+		if (left)
+			borders.push_back(3 * (cluster - 1));
+		if (right)
+			borders.push_back(3 * cluster);
+		if (top)
+			borders.push_back(3 * (cluster - clusterCols) + 1);
+		if (bottom)
+			borders.push_back(3 * cluster + 1);
+		// The corners the cell lies around
+		if (bottom && right)
+			borders.push_back(3 * cluster + 2);
+		if (bottom && left)
+			borders.push_back(3 * (cluster - 1) + 2);
+		if (top && right)
+			borders.push_back(3 * (cluster - clusterCols) + 2);
+		if (top && left)
+			borders.push_back(3 * (cluster - clusterCols - 1) + 2);
+
+		for (size_t k = 0; k < borders.size(); k++) {
+			clearBorder(borders[k]);
+			buildBorder(borders[k]);
+			// The clusters on the other side may have gained or lost nodes
+			std::vector<int> around = clustersAround(borders[k]);
+			for (size_t c = 0; c < around.size(); c++)
+				if (std::find(clusters.begin(), clusters.end(), around[c]) == clusters.end())
+					clusters.push_back(around[c]);
+		}
+		for (size_t k = 0; k < clusters.size(); k++)
+			buildIntraEdges(clusters[k]);
+	}
+
+	// The cells from src to dest, or an empty path when dest cannot be reached or either
+	// end is blocked or outside the map. Unlike aStarSearch, the path is near-optimal
+	// rather than optimal.
+	std::vector<Pair> findPath(Pair src, Pair dest)
+	{
+		expanded = 0;
+		if (!grid.isValid(src.first, src.second) || !grid.isValid(dest.first, dest.second)
+			|| !grid.isUnBlocked(src.first, src.second) || !grid.isUnBlocked(dest.first, dest.second))
+			return std::vector<Pair>();
+		if (src == dest)
+			return std::vector<Pair>(1, src);
+
+		int srcCluster = clusterOf(src.first, src.second);
+		int destCluster = clusterOf(dest.first, dest.second);
+
+		// Same or neighbouring clusters: search them and the clusters around them
+		// directly. A path as short as the octile distance is optimal; any other may be
+		// beaten by one going further, so the abstract search runs too and the cheaper
+		// path wins.
+		std::vector<Pair> direct;
+		double directCost = std::numeric_limits<double>::infinity();
+		if (std::abs(srcCluster / clusterCols - destCluster / clusterCols) <= 1 &&
+			std::abs(srcCluster % clusterCols - destCluster % clusterCols) <= 1) {
+			ClusterBounds s = boundsOf(srcCluster), d = boundsOf(destCluster);
+			ClusterBounds around{ std::max(0, std::min(s.row0, d.row0) - clusterSize),
+				std::max(0, std::min(s.col0, d.col0) - clusterSize),
+				std::min(grid.getRows(), std::max(s.row1, d.row1) + clusterSize),
+				std::min(grid.getCols(), std::max(s.col1, d.col1) + clusterSize) };
+			bool found = boundedSearch(grid, src, dest, around, cellState);
+			expanded = cellState.getExpanded();
+			if (found) {
+				directCost = cellState.getG(around.localIndex(dest.first, dest.second));
+				direct = traceBoundedPath(around, cellState, dest);
+				int dr = std::abs(src.first - dest.first), dc = std::abs(src.second - dest.second);
+				double octile = std::max(dr, dc) + (DIAGONAL_COST - 1.0) * std::min(dr, dc);
+				if (directCost <= octile + 1e-9)
+					return direct;
+			}
+		}
+
+		// Abstract search over the node ids plus two virtual nodes for src and dest
+		const uint32_t SRC = (uint32_t)nodes.size(), DEST = SRC + 1;
+		if (searchStamp.size() < nodes.size() + 2) {
+			searchStamp.resize(nodes.size() + 2, 0);
+			searchG.resize(nodes.size() + 2);
+			searchParent.resize(nodes.size() + 2);
+		}
+		if (++searchGeneration == 0) {
+			std::fill(searchStamp.begin(), searchStamp.end(), 0);
+			searchGeneration = 1;
+		}
+
+		std::vector<Edge> srcEdges = connect(src, srcCluster);
+		std::vector<Edge> destEdges = connect(dest, destCluster); // Costs are symmetric
+
+		abstractHeap.reserveItems(nodes.size() + 2);
+		abstractHeap.clear();
+		searchStamp[SRC] = searchGeneration;
+		searchG[SRC] = 0.0;
+		abstractHeap.push(SRC, 0.0);
+
+		while (!abstractHeap.empty()) {
+			uint32_t u = abstractHeap.pop();
+			if (u == DEST)
+				break;
+			expanded++;
+
+			// Gather the edges of u: cached ones, plus the virtual edges to DEST
+			std::vector<Edge> edges;
+			if (u == SRC) {
+				edges = srcEdges;
+			}
+			else {
+				edges = nodes[u].interEdges;
+				edges.insert(edges.end(), nodes[u].intraEdges.begin(), nodes[u].intraEdges.end());
+				if (nodes[u].cluster == destCluster)
+					for (size_t k = 0; k < destEdges.size(); k++)
+						if (destEdges[k].to == u)
+							edges.push_back(Edge{ DEST, destEdges[k].cost });
+			}
+
+			for (size_t k = 0; k < edges.size(); k++) {
+				uint32_t v = edges[k].to;
+				double gNew = searchG[u] + edges[k].cost;
+				if (searchStamp[v] == searchGeneration && searchG[v] <= gNew)
+					continue;
+				searchStamp[v] = searchGeneration;
+				searchG[v] = gNew;
+				searchParent[v] = u;
+				Pair cell = v == DEST ? dest : Pair(grid.rowOf(nodes[v].cell), grid.colOf(nodes[v].cell));
+				abstractHeap.pushOrDecrease(v, gNew + calculateHValue(cell.first, cell.second, dest));
+			}
+		}
+		if (searchStamp[DEST] != searchGeneration || directCost <= searchG[DEST])
+			return direct;
+
+		// Abstract path from SRC to DEST as cells
+		std::vector<Pair> waypoints;
+		for (uint32_t v = DEST; v != SRC; v = searchParent[v])
+			waypoints.push_back(v == DEST ? dest : Pair(grid.rowOf(nodes[v].cell), grid.colOf(nodes[v].cell)));
+		waypoints.push_back(src);
+		std::reverse(waypoints.begin(), waypoints.end());
+
+		// Refinement: consecutive waypoints are either the two cells of a transition or
+		// two cells of the same cluster
+		std::vector<Pair> path(1, src);
+		for (size_t k = 1; k < waypoints.size(); k++) {
+			if (clusterOf(waypoints[k - 1].first, waypoints[k - 1].second) != clusterOf(waypoints[k].first, waypoints[k].second))
+				path.push_back(waypoints[k]);
+			else if (!refine(waypoints[k - 1], waypoints[k], path))
+				return std::vector<Pair>();
+		}
+		return path;
+	}
+};
+
+#endif
@@ -0,0 +1,129 @@
+// IndexedHeap.h
+// Indexed d-ary min-heap with decrease-key, used as the A* open list
+
+#ifndef INDEXEDHEAP_H
+#define INDEXEDHEAP_H
+
+#include <vector>
+#include <cstdint>
+
+// Min-heap of items 0..n-1 ordered by a key (double, or an integer type for
+// fixed-point costs).
+// - D children per node: D = 2 is a binary heap, D = 4 keeps the sift-down
+//   comparisons of one level in a single cache line and the tree half as deep.
+// - pos[item] remembers where an item sits in the heap so decreaseKey can sift it
+//   up in place instead of inserting a duplicate entry.
+// - pos is never cleared: an item is in the heap only if pos[item] points at an
+//   entry holding that item, so clear() is O(1) even for 100M possible items.
+template <int D = 4, class Key = double>
+class IndexedDaryHeap {
+private:
+	struct Entry {
+		Key key;
+		uint32_t item;
+	};
+
+	std::vector<Entry> heap;
+	std::vector<uint32_t> pos;
+
+	void place(size_t index, const Entry& entry)
+	{
+		heap[index] = entry;
+		pos[entry.item] = (uint32_t)index;
+	}
+
+	void siftUp(size_t index)
+	{
+		Entry entry = heap[index];
+		while (index > 0) {
+			size_t parent = (index - 1) / D;
+			if (heap[parent].key <= entry.key)
+				break;
+			place(index, heap[parent]);
+			index = parent;
+		}
+		place(index, entry);
+	}
+
+	void siftDown(size_t index)
+	{
+		Entry entry = heap[index];
+		size_t n = heap.size();
+		while (true) {
+			size_t first = index * D + 1;
+			if (first >= n)
+				break;
+			size_t best = first;
+			size_t last = first + D < n ? first + D : n;
+			for (size_t c = first + 1; c < last; c++)
+				if (heap[c].key < heap[best].key)
+					best = c;
+			if (entry.key <= heap[best].key)
+				break;
+			place(index, heap[best]);
+			index = best;
+		}
+		place(index, entry);
+	}
+
+public:
+	// Items must be smaller than n
+	void reserveItems(size_t n)
+	{
+		if (pos.size() < n)
+			pos.resize(n);
+	}
+
+	bool empty() const { return heap.empty(); }
+	size_t size() const { return heap.size(); }
+	void clear() { heap.clear(); }
+
+	bool contains(uint32_t item) const
+	{
+		uint32_t p = pos[item];
+		return p < heap.size() && heap[p].item == item;
+	}
+
+	Key keyOf(uint32_t item) const { return heap[pos[item]].key; }
+
+	void push(uint32_t item, Key key)
+	{
+		heap.push_back(Entry{ key, item });
+		siftUp(heap.size() - 1);
+	}
+
+	// The new key must not be larger than the current one
+	void decreaseKey(uint32_t item, Key key)
+	{
+		size_t index = pos[item];
+		heap[index].key = key;
+		siftUp(index);
+	}
+
+	// Insert the item, or lower its key if it is already queued with a larger one
+	void pushOrDecrease(uint32_t item, Key key)
+	{
+		if (!contains(item))
+			push(item, key);
+		else if (key < keyOf(item))
+			decreaseKey(item, key);
+	}
+
+	uint32_t top() const { return heap[0].item; }
+	Key topKey() const { return heap[0].key; }
+
+	// Remove and return the item with the smallest key
+	uint32_t pop()
+	{
+		uint32_t item = heap[0].item;
+		Entry last = heap.back();
+		heap.pop_back();
+		if (!heap.empty()) {
+			heap[0] = last;
+			siftDown(0);
+		}
+		return item;
+	}
+};
+
+#endif
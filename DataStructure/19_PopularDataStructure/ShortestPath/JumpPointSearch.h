@@ -0,0 +1,331 @@
+// JumpPointSearch.h
+// Jump Point Search (Harabor & Grastien) for uniform-cost 8-connected grids
+
+#ifndef JUMPPOINTSEARCH_H
+#define JUMPPOINTSEARCH_H
+
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <cstdlib>
+#include "GridPathfinding.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*
+* Jump Point Search returns the same optimal path costs as aStarSearch on the same
+* GridMap, but only puts "jump points" on the open list: cells where an optimal path
+* may have to turn because an obstacle creates a forced neighbour. On open terrain
+* a straight or diagonal run of thousands of cells costs one open-list entry.
+*
+* - BitGrid: a copy of the map with every line (row or column) padded with blocked
+*   cells, so 64 consecutive cells of any line can be read as one word.
+* - JumpPointMap: built once per map. Holds the map row by row and transposed
+*   (column by column), so both horizontal and vertical jumps scan 64 cells per step
+*   using word operations instead of one cell at a time.
+* - jumpPointSearch(jmap, src, dest, state): same contract as aStarSearch. The state
+*   and its 4-ary heap are shared with A*, so the same scratch works for both.
+*/
+
+inline int lowestBit(uint64_t x)
+{
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanForward64(&i, x);
+	return (int)i;
+#else
+	return __builtin_ctzll(x);
+#endif
+}
+
+inline int highestBit(uint64_t x)
+{
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanReverse64(&i, x);
+	return (int)i;
+#else
+	return 63 - __builtin_clzll(x);
+#endif
+}
+
+// Returned by the jump functions when a blocked cell comes before any jump point
+const int NO_JUMP = std::numeric_limits<int>::min();
+
+class BitGrid {
+private:
+	static const int PAD = 128; // Blocked cells before and after every line
+	int lines, length;
+	size_t lineWords;
+	std::vector<uint64_t> words; // Lines -1 and `lines` are all blocked as well
+
+public:
+	BitGrid() : lines(0), length(0), lineWords(0) {}
+
+	BitGrid(int lines, int length)
+		: lines(lines), length(length), lineWords((length + 2 * PAD + 64) / 64 + 1),
+		  words((size_t)(lines + 2) * lineWords, 0)
+	{
+	}
+
+	void setFree(int line, int pos)
+	{
+		size_t p = (size_t)(pos + PAD);
+		words[(size_t)(line + 1) * lineWords + (p >> 6)] |= 1ULL << (p & 63);
+	}
+
+	// Bit i is set when cell (line, start + i) is inside the map and not blocked
+	uint64_t bitsAt(int line, int start) const
+	{
+		size_t p = (size_t)(start + PAD);
+		const uint64_t* w = &words[(size_t)(line + 1) * lineWords + (p >> 6)];
+		unsigned s = p & 63;
+		return s == 0 ? w[0] : (w[0] >> s) | (w[1] << (64 - s));
+	}
+
+	// Walk along line from pos (inclusive) in direction step = +1 or -1 and return
+	// the first cell that is a jump point: the goal, or a cell with a forced
+	// neighbour in one of the two adjacent lines. Returns NO_JUMP when a blocked
+	// cell comes first.
+	int scan(int line, int pos, int step, int goalPos) const
+	{
+		if (step > 0) {
+			for (;; pos += 64) {
+				uint64_t here = bitsAt(line, pos);
+				uint64_t stop = ~here
+					| (~bitsAt(line - 1, pos) & bitsAt(line - 1, pos + 1))
+					| (~bitsAt(line + 1, pos) & bitsAt(line + 1, pos + 1));
+				if (goalPos >= pos && goalPos < pos + 64)
+					stop |= 1ULL << (goalPos - pos);
+				if (stop) {
+					int i = lowestBit(stop);
+					return (here >> i) & 1 ? pos + i : NO_JUMP;
+				}
+			}
+		}
+		for (;; pos -= 64) {
+			int start = pos - 63;
+			uint64_t here = bitsAt(line, start);
+			uint64_t stop = ~here
+				| (~bitsAt(line - 1, start) & bitsAt(line - 1, start - 1))
+				| (~bitsAt(line + 1, start) & bitsAt(line + 1, start - 1));
+			if (goalPos >= start && goalPos <= pos)
+				stop |= 1ULL << (goalPos - start);
+			if (stop) {
+				int i = highestBit(stop);
+				return (here >> i) & 1 ? start + i : NO_JUMP;
+			}
+		}
+	}
+};
+
+class JumpPointMap {
+private:
+	const GridMap& grid;
+	BitGrid byRow;    // line = row, position = column
+	BitGrid byColumn; // line = column, position = row
+
+public:
+	explicit JumpPointMap(const GridMap& grid)
+		: grid(grid), byRow(grid.getRows(), grid.getCols()), byColumn(grid.getCols(), grid.getRows())
+	{
+		for (int i = 0; i < grid.getRows(); i++)
+			for (int j = 0; j < grid.getCols(); j++)
+				if (grid.isUnBlocked(i, j)) {
+					byRow.setFree(i, j);
+					byColumn.setFree(j, i);
+				}
+	}
+
+	const GridMap& getGrid() const { return grid; }
+
+	bool isFree(int row, int col) const
+	{
+		return grid.isValid(row, col) && grid.isUnBlocked(row, col);
+	}
+
+	// Jump from (row, col) along a row (dc = +1/-1) or a column (dr = +1/-1).
+	// Returns the column or row of the jump point, or NO_JUMP.
+	int jumpHorizontal(int row, int col, int dc, Pair dest) const
+	{
+		return byRow.scan(row, col + dc, dc, dest.first == row ? dest.second : NO_JUMP);
+	}
+
+	int jumpVertical(int row, int col, int dr, Pair dest) const
+	{
+		return byColumn.scan(col, row + dr, dr, dest.second == col ? dest.first : NO_JUMP);
+	}
+
+	// Jump diagonally from (row, col). Stops on the goal, on a cell with a forced
+	// neighbour, or on a cell from which a straight jump finds a jump point.
+	bool jumpDiagonal(int row, int col, int dr, int dc, Pair dest, Pair& jump) const
+	{
+		while (true) {
+			row += dr;
+			col += dc;
+			if (!isFree(row, col))
+				return false;
+			if ((row == dest.first && col == dest.second)
+				|| (!isFree(row, col - dc) && isFree(row + dr, col - dc))
+				|| (!isFree(row - dr, col) && isFree(row - dr, col + dc))
+				|| jumpHorizontal(row, col, dc, dest) != NO_JUMP
+				|| jumpVertical(row, col, dr, dest) != NO_JUMP) {
+				jump = Pair(row, col);
+				return true;
+			}
+		}
+	}
+};
+
+// Index into DIR_ROW/DIR_COL of the move (dr, dc)
+inline uint8_t directionIndex(int dr, int dc)
+{
+	for (uint8_t d = 0; d < 8; d++)
+		if (DIR_ROW[d] == dr && DIR_COL[d] == dc)
+			return d;
+	return GridSearchState::NO_PARENT;
+}
+
+// Rebuild the full cell path. Every jump is a straight or diagonal run, so the
+// cells between a jump point and its parent are filled in by stepping back along
+// the stored direction.
+inline std::vector<Pair> traceJumpPath(const GridMap& grid, const GridSearchState& state, Pair dest)
+{
+	std::vector<Pair> path;
+	size_t cell = grid.index(dest.first, dest.second);
+	uint8_t dir;
+
+	path.push_back(dest);
+	while ((dir = state.getParentDir(cell)) != GridSearchState::NO_PARENT) {
+		size_t parent = state.parentCell[cell];
+		int row = grid.rowOf(cell);
+		int col = grid.colOf(cell);
+		do {
+			row -= DIR_ROW[dir];
+			col -= DIR_COL[dir];
+			path.push_back(Pair(row, col));
+		} while (grid.index(row, col) != parent);
+		cell = parent;
+	}
+	std::reverse(path.begin(), path.end());
+	return path;
+}
+
+// Find the shortest path between the source cell and the destination cell with
+// Jump Point Search. Same contract as aStarSearch.
+inline std::vector<Pair> jumpPointSearch(const JumpPointMap& jmap, Pair src, Pair dest, GridSearchState& state)
+{
+	const GridMap& grid = jmap.getGrid();
+
+	// Either the source or the destination is out of range or blocked
+	if (!jmap.isFree(src.first, src.second) || !jmap.isFree(dest.first, dest.second))
+		return std::vector<Pair>();
+
+	state.reset(grid.size(), true);
+	state.open(grid.index(src.first, src.second), 0.0, GridSearchState::NO_PARENT);
+
+	HeapOpenList<4> openList(state.quadHeap, grid.size());
+	openList.clear();
+	openList.push((uint32_t)grid.index(src.first, src.second), 0.0);
+
+	while (!openList.empty()) {
+		uint32_t current = openList.pop();
+		int i = grid.rowOf(current);
+		int j = grid.colOf(current);
+
+		if (i == dest.first && j == dest.second)
+			return traceJumpPath(grid, state, dest);
+
+		state.close(current);
+		double g = state.getG(current);
+
+		// Directions worth jumping in: all 8 from the source, otherwise the natural
+		// and forced neighbours for the direction we arrived in
+		int dirs[8][2];
+		int count = 0;
+		uint8_t in = state.getParentDir(current);
+		if (in == GridSearchState::NO_PARENT) {
+			for (int d = 0; d < 8; d++) {
+				dirs[count][0] = DIR_ROW[d];
+				dirs[count][1] = DIR_COL[d];
+				count++;
+			}
+		}
+		else {
+			int dr = DIR_ROW[in];
+			int dc = DIR_COL[in];
+			if (dr != 0 && dc != 0) {
+				dirs[count][0] = dr; dirs[count][1] = 0; count++;
+				dirs[count][0] = 0; dirs[count][1] = dc; count++;
+				dirs[count][0] = dr; dirs[count][1] = dc; count++;
+				if (!jmap.isFree(i, j - dc)) {
+					dirs[count][0] = dr; dirs[count][1] = -dc; count++;
+				}
+				if (!jmap.isFree(i - dr, j)) {
+					dirs[count][0] = -dr; dirs[count][1] = dc; count++;
+				}
+			}
+			else if (dr == 0) {
+				dirs[count][0] = 0; dirs[count][1] = dc; count++;
+				if (!jmap.isFree(i - 1, j)) {
+					dirs[count][0] = -1; dirs[count][1] = dc; count++;
+				}
+				if (!jmap.isFree(i + 1, j)) {
+					dirs[count][0] = 1; dirs[count][1] = dc; count++;
+				}
+			}
+			else {
+				dirs[count][0] = dr; dirs[count][1] = 0; count++;
+				if (!jmap.isFree(i, j - 1)) {
+					dirs[count][0] = dr; dirs[count][1] = -1; count++;
+				}
+				if (!jmap.isFree(i, j + 1)) {
+					dirs[count][0] = dr; dirs[count][1] = 1; count++;
+				}
+			}
+		}
+
+		for (int k = 0; k < count; k++) {
+			int dr = dirs[k][0];
+			int dc = dirs[k][1];
+			Pair jump;
+			double gNew;
+
+			if (dr != 0 && dc != 0) {
+				if (!jmap.jumpDiagonal(i, j, dr, dc, dest, jump))
+					continue;
+				gNew = g + std::abs(jump.first - i) * DIAGONAL_COST;
+			}
+			else if (dr == 0) {
+				int col = jmap.jumpHorizontal(i, j, dc, dest);
+				if (col == NO_JUMP)
+					continue;
+				jump = Pair(i, col);
+				gNew = g + std::abs(col - j);
+			}
+			else {
+				int row = jmap.jumpVertical(i, j, dr, dest);
+				if (row == NO_JUMP)
+					continue;
+				jump = Pair(row, j);
+				gNew = g + std::abs(row - i);
+			}
+
+			size_t next = grid.index(jump.first, jump.second);
+			if (state.isClosed(next))
+				continue;
+			if (gNew < state.getG(next)) {
+				state.open(next, gNew, directionIndex(dr, dc));
+				state.parentCell[next] = current;
+				openList.push((uint32_t)next, gNew + calculateHValue(jump.first, jump.second, dest));
+			}
+		}
+	}
+
+	// The open list is empty: there is no way to the destination cell (due to blockages)
+	return std::vector<Pair>();
+}
+
+#endif
@@ -0,0 +1,258 @@
+// Benchmark of the grid pathfinding solvers on the standard .map / .scen format
+// (the Moving AI Lab grid benchmark sets, https://movingai.com/benchmarks/grids.html)
+//
+// Usage: PathfindingBenchmark <file.map> <file.map.scen> [solver ...]
+//
+// Every scenario of the .scen file is solved by each solver variant. For each variant
+// the benchmark reports:
+// - nodes: total open-list expansions (cells for A* and JPS, abstract nodes for HPA*)
+// - memory: peak heap bytes allocated by the variant, preprocessing included
+// - build: preprocessing time (landmarks, jump point map, HPA* abstraction)
+// - p50 / p99 / max: per-query latency
+// - cost: how far the total path cost is from the first optimal solver run (0% = optimal)
+//
+// Movement follows aStarSearch (8-connected, diagonal corner-cutting allowed), while
+// the optimal lengths in .scen files forbid corner-cutting, so those lengths are upper
+// bounds here and are not compared against.
+//
+// Map cells '.', 'G' and 'S' are passable; '@', 'O', 'T' and 'W' are blocked.
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <cstdint>
+#include "GridPathfinding.h"
+#include "JumpPointSearch.h"
+#include "HierarchicalPathfinding.h"
+#include "GridHeuristics.h"
+using namespace std;
+
+// Heap accounting: every allocation is prefixed with its size so the current and peak
+// number of live bytes can be tracked without a custom allocator in the solvers
+static size_t liveBytes = 0, peakBytes = 0;
+static const size_t ALLOC_HEADER = 16; // Keeps the returned block 16-byte aligned
+
+void* operator new(size_t size)
+{
+	char* block = (char*)malloc(size + ALLOC_HEADER);
+	if (!block)
+		throw bad_alloc();
+	*(size_t*)block = size;
+	liveBytes += size;
+	peakBytes = max(peakBytes, liveBytes);
+	return block + ALLOC_HEADER;
+}
+
+void operator delete(void* p) noexcept
+{
+	if (!p)
+		return;
+	// Integer arithmetic: the header lies before the object the compiler knows about
+	char* block = (char*)((uintptr_t)p - ALLOC_HEADER);
+	liveBytes -= *(size_t*)block;
+	free(block);
+}
+
+void* operator new[](size_t size) { return operator new(size); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+
+struct Scenario {
+	Pair src, dest;
+};
+
+// Read a .map file. Returns false when the file is missing or malformed.
+bool loadMap(const string& fileName, vector<string>& rows)
+{
+	ifstream in(fileName);
+	string key, value;
+	int height = -1, width = -1;
+	while (in >> key) {
+		if (key == "map")
+			break;
+		in >> value;
+		if (key == "height")
+			height = atoi(value.c_str());
+		else if (key == "width")
+			width = atoi(value.c_str());
+	}
+	if (height <= 0 || width <= 0)
+		return false;
+
+	rows.assign(height, string());
+	for (int i = 0; i < height; i++)
+		if (!(in >> rows[i]) || (int)rows[i].size() != width)
+			return false;
+	return true;
+}
+
+// Read a .scen file (version 1): bucket, map, width, height, start x, start y,
+// goal x, goal y, optimal length. x is the column and y the row.
+bool loadScenarios(const string& fileName, vector<Scenario>& scenarios)
+{
+	ifstream in(fileName);
+	string line;
+	if (!getline(in, line) || line.compare(0, 7, "version") != 0)
+		return false;
+	while (getline(in, line)) {
+		istringstream fields(line);
+		int bucket, width, height, sx, sy, gx, gy;
+		string map;
+		double optimal;
+		if (fields >> bucket >> map >> width >> height >> sx >> sy >> gx >> gy >> optimal)
+			scenarios.push_back(Scenario{ make_pair(sy, sx), make_pair(gy, gx) });
+	}
+	return !scenarios.empty();
+}
+
+// Cost of a path of 8-connected moves
+double pathCost(const vector<Pair>& path)
+{
+	double cost = 0.0;
+	for (size_t k = 1; k < path.size(); k++)
+		cost += (path[k].first != path[k - 1].first && path[k].second != path[k - 1].second) ? DIAGONAL_COST : 1.0;
+	return cost;
+}
+
+// One solver under test. build() does the preprocessing and allocates the scratch,
+// solve() answers one query, expanded() reports the expansions of the last query.
+struct SolverVariant {
+	string name;
+	function<void()> build;
+	function<vector<Pair>(Pair, Pair)> solve;
+	function<size_t()> expanded;
+	function<void()> release;
+};
+
+double percentile(vector<double> values, double p)
+{
+	if (values.empty())
+		return 0.0;
+	sort(values.begin(), values.end());
+	size_t k = (size_t)(p * (values.size() - 1) + 0.5);
+	return values[k];
+}
+
+// Driver program to run the benchmark
+int main(int argc, char* argv[])
+{
+	if (argc < 3) {
+		printf("Usage: %s <file.map> <file.map.scen> [solver ...]\n", argv[0]);
+		printf("Solvers: astar-set astar-binary astar-quad jps fixed-octile alt hpa (default: all)\n");
+		return 1;
+	}
+
+	vector<string> rows;
+	vector<Scenario> scenarios;
+	if (!loadMap(argv[1], rows)) {
+		printf("Cannot read map %s\n", argv[1]);
+		return 1;
+	}
+	if (!loadScenarios(argv[2], scenarios)) {
+		printf("Cannot read scenarios %s\n", argv[2]);
+		return 1;
+	}
+
+	int height = (int)rows.size(), width = (int)rows[0].size();
+	GridMap grid(height, width);
+	for (int i = 0; i < height; i++)
+		for (int j = 0; j < width; j++)
+			grid.setBlocked(i, j, !(rows[i][j] == '.' || rows[i][j] == 'G' || rows[i][j] == 'S'));
+	printf("%s: %dx%d, %zu scenarios\n\n", argv[1], height, width, scenarios.size());
+
+	// Scratch and preprocessed data of every variant, created by build()
+	GridSearchState* state = nullptr;
+	FixedSearchState* fixedState = nullptr;
+	JumpPointMap* jmap = nullptr;
+	LandmarkHeuristic* landmarks = nullptr;
+	GridMap* hpaGrid = nullptr;
+	HierarchicalPathfinder* hpa = nullptr;
+
+	auto astar = [&](const string& name, OpenListType type) {
+		return SolverVariant{ name,
+			[&] { state = new GridSearchState(); },
+			[&, type](Pair s, Pair d) { return aStarSearch(grid, s, d, *state, type); },
+			[&] { return state->getExpanded(); },
+			[&] { delete state; state = nullptr; } };
+	};
+	vector<SolverVariant> variants = {
+		astar("astar-set", SET_OPEN_LIST),
+		astar("astar-binary", BINARY_HEAP_OPEN_LIST),
+		astar("astar-quad", QUAD_HEAP_OPEN_LIST),
+		SolverVariant{ "jps",
+			[&] { state = new GridSearchState(); jmap = new JumpPointMap(grid); },
+			[&](Pair s, Pair d) { return jumpPointSearch(*jmap, s, d, *state); },
+			[&] { return state->getExpanded(); },
+			[&] { delete jmap; delete state; jmap = nullptr; state = nullptr; } },
+		SolverVariant{ "fixed-octile",
+			[&] { fixedState = new FixedSearchState(); },
+			[&](Pair s, Pair d) { return aStarSearchFixed(grid, s, d, *fixedState); },
+			[&] { return fixedState->getExpanded(); },
+			[&] { delete fixedState; fixedState = nullptr; } },
+		SolverVariant{ "alt",
+			[&] { fixedState = new FixedSearchState(); landmarks = new LandmarkHeuristic(grid, 8); },
+			[&](Pair s, Pair d) { return aStarSearchFixed(grid, s, d, *fixedState, landmarks); },
+			[&] { return fixedState->getExpanded(); },
+			[&] { delete landmarks; delete fixedState; landmarks = nullptr; fixedState = nullptr; } },
+		SolverVariant{ "hpa",
+			[&] { hpaGrid = new GridMap(grid); hpa = new HierarchicalPathfinder(*hpaGrid, 16); },
+			[&](Pair s, Pair d) { return hpa->findPath(s, d); },
+			[&] { return hpa->getExpanded(); },
+			[&] { delete hpa; delete hpaGrid; hpa = nullptr; hpaGrid = nullptr; } },
+	};
+
+	// Reference costs for the cost column, from the first optimal solver that runs
+	vector<double> reference;
+
+	printf("%-14s %12s %12s %10s %10s %10s %10s %8s %7s\n",
+		"solver", "nodes", "memory", "build ms", "p50 us", "p99 us", "max us", "cost", "failed");
+	for (SolverVariant& v : variants) {
+		if (argc > 3 && find(argv + 3, argv + argc, v.name) == argv + argc)
+			continue;
+
+		size_t baseline = liveBytes;
+		peakBytes = liveBytes;
+		auto begin = chrono::steady_clock::now();
+		v.build();
+		double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+
+		vector<double> latency;
+		latency.reserve(scenarios.size());
+		vector<double> costs(scenarios.size());
+		size_t nodes = 0, failed = 0;
+		for (size_t k = 0; k < scenarios.size(); k++) {
+			auto start = chrono::steady_clock::now();
+			vector<Pair> path = v.solve(scenarios[k].src, scenarios[k].dest);
+			latency.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+			nodes += v.expanded();
+			costs[k] = pathCost(path);
+			failed += path.empty() && scenarios[k].src != scenarios[k].dest;
+		}
+		size_t memory = peakBytes - baseline;
+		v.release();
+
+		bool optimal = v.name != "hpa";
+		if (reference.empty() && optimal)
+			reference = costs;
+		double total = 0.0, referenceTotal = 0.0;
+		for (size_t k = 0; k < costs.size() && !reference.empty(); k++) {
+			total += costs[k];
+			referenceTotal += reference[k];
+		}
+		char cost[16] = "-";
+		if (referenceTotal > 0.0)
+			snprintf(cost, sizeof(cost), "%+.2f%%", 100.0 * (total / referenceTotal - 1.0));
+
+		printf("%-14s %12zu %12zu %10.1f %10.1f %10.1f %10.1f %8s %7zu\n", v.name.c_str(), nodes, memory, buildMs,
+			percentile(latency, 0.50), percentile(latency, 0.99), percentile(latency, 1.0), cost, failed);
+	}
+
+	return (0);
+}